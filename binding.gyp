@@ -2,19 +2,46 @@
   "targets": [
     {
       "target_name": "homebridge-bme280",
+      "variables": {
+        # Default compensation variant: INT64, INT32 or FLOAT
+        "bme280_compensation%": "INT64"
+      },
       "cflags!": [ "-fno-exceptions" ],
       "cflags_cc!": [ "-fno-exceptions" ],
       "sources": [
         "src/binding/binding.cpp",
         "src/binding/binding_utils.cpp",
-        "src/c/bme280.c"
+        "src/binding/bme280_device.cpp",
+        "src/binding/bme280_handle.cpp",
+        "src/c/bme280.c",
+        "src/c/compensate.c",
+        "src/c/sw_filter.c"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
         "src/c",
         "src/binding"
       ],
-      'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS' ],
+      'defines': [
+        'NAPI_DISABLE_CPP_EXCEPTIONS',
+        'NAPI_VERSION=6',
+        'BME280_COMPENSATION=COMPENSATION_<(bme280_compensation)'
+      ],
+      "dependencies": [ "bme280-derived" ],
+      "libraries": [ "-lm" ],
+    },
+    {
+      # Built separately so only the derived-metrics loops get -ffast-math,
+      # which lets the compiler use vectorized exp/log
+      "target_name": "bme280-derived",
+      "type": "static_library",
+      "cflags": [ "-O3", "-ffast-math", "-fPIC" ],
+      "sources": [
+        "src/c/derived.c"
+      ],
+      "include_dirs": [
+        "src/c"
+      ],
     }
   ]
 }
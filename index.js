@@ -22,6 +22,8 @@ function BME280Accessory(log, config) {
   this.log = log;
   this.displayName = config['name'];
   this.i2cInterface = config['i2cAdaptor'] || '/dev/i2c-3';
+  this.profile = config['profile'];
+  this.softwareFilter = config['softwareFilter'];
   this.enableFakeGato = config['enableFakeGato'] || false;
   this.fakeGatoStoragePath = config['fakeGatoStoragePath'];
   this.enableMQTT = config['enableMQTT'] || false;
@@ -231,16 +233,35 @@ BME280Accessory.prototype.publishToMQTT = function(topic, value) {
 
 // Set up sensor; checks that I2C interface is available and device is ready
 BME280Accessory.prototype.setupBME280 = function() {
-  data = BME280.init(this.i2cInterface);
-  if (data.hasOwnProperty('errcode')) {
-    this.log(`Error: ${data.errmsg}`);
+  let data;
+
+  // Handle to the sensor, passed to every other call; if init fails, this
+  // is an error object, and later calls report that the device is not open
+  this.device = BME280.init(this.i2cInterface);
+  if (this.device.hasOwnProperty('errcode')) {
+    this.log(`Error: ${this.device.errmsg}`);
+    return;
+  }
+
+  if (this.profile) {
+    data = BME280.setProfile(this.device, this.profile);
+    if (data.hasOwnProperty('errcode')) {
+      this.log(`Error: ${data.errmsg}`);
+    }
+  }
+
+  if (this.softwareFilter) {
+    data = BME280.setSoftwareFilter(this.device, this.softwareFilter);
+    if (data.hasOwnProperty('errcode')) {
+      this.log(`Error: ${data.errmsg}`);
+    }
   }
 }
 
 // Read pressure and temperature from sensor
 BME280Accessory.prototype.refreshData = function() {
   let data;
-  data = BME280.measure();
+  data = BME280.measure(this.device);
 
   if (data.hasOwnProperty('errcode')) {
     this.log(`Error: ${data.errmsg}`);
@@ -255,9 +276,17 @@ BME280Accessory.prototype.refreshData = function() {
   this.log.debug(`Read: Pressure: ${data.pressure}pa` + 
                  `Temperature: ${data.temperature}C ` +
                  `Humidity: ${data.humidity}%`); 
-  this.pressure = data.pressure;
-  this.temperature = data.temperature;
-  this.humidity = data.humidity;
+
+  // Channels skipped by the sensor profile are left out, and never published
+  if (data.hasOwnProperty('pressure')) {
+    this.pressure = data.pressure;
+  }
+  if (data.hasOwnProperty('temperature')) {
+    this.temperature = data.temperature;
+  }
+  if (data.hasOwnProperty('humidity')) {
+    this.humidity = data.humidity;
+  }
 }
 
 BME280Accessory.prototype.getServices = function() {
@@ -1,13 +1,100 @@
 extern "C" {
 #include "bme280.h"
+#include "derived.h"
 }
 
 #include "binding_utils.h"
+#include "bme280_device.h"
+#include "bme280_handle.h"
 
 #include <napi.h>
 
+#include <cmath>
+#include <memory>
+#include <mutex>
 #include <string>
 
+// Names used from Javascript, indexed by Preset
+static const char *preset_names[PRESET_COUNT] = {
+  "weatherMonitoring",
+  "humiditySensing",
+  "indoorNavigation",
+  "gaming"
+};
+
+// Names used from Javascript, indexed by Compensation
+static const char *compensation_names[] = {
+  "int64",
+  "int32",
+  "float"
+};
+
+// Returns the name of the preset that profile matches, or "custom"
+static const char *profile_name(const struct BME280_profile &profile) {
+  for (int preset = 0; preset < PRESET_COUNT; preset++) {
+    struct BME280_profile candidate;
+    BME280_get_preset(static_cast<enum Preset>(preset), &candidate);
+    if (candidate.osrs_h == profile.osrs_h &&
+        candidate.osrs_t == profile.osrs_t &&
+        candidate.osrs_p == profile.osrs_p &&
+        candidate.mode == profile.mode &&
+        candidate.standby == profile.standby &&
+        candidate.filter_coefficient == profile.filter_coefficient) {
+      return preset_names[preset];
+    }
+  }
+  return "custom";
+}
+
+// Channels the cached profile actually measures; skipped ones read back as
+// the chip's reset values, which compensate to believable constants.
+// Pressure and humidity compensation depend on temperature, so without it
+// nothing is valid.
+struct MeasuredChannels {
+  bool pressure;
+  bool temperature;
+  bool humidity;
+};
+
+static MeasuredChannels measured_channels(struct BME280_dev *dev) {
+  struct BME280_profile profile;
+  BME280_get_profile(dev, &profile);
+
+  MeasuredChannels channels;
+  channels.temperature = profile.osrs_t != T_OVERSAMPLE_SKIP;
+  channels.pressure = channels.temperature && profile.osrs_p != P_OVERSAMPLE_SKIP;
+  channels.humidity = channels.temperature && profile.osrs_h != H_OVERSAMPLE_SKIP;
+  return channels;
+}
+
+// Checked here rather than in derived.c, which is built with -ffast-math
+// and so cannot reliably test for NaN or infinity
+static bool valid_elevation(double elevation) {
+  return std::isfinite(elevation) && elevation < DERIVED_MAX_ELEVATION;
+}
+
+// Overwrites field with object[key], if it is present; returns false,
+// leaving field alone, if the value is not an integer from 0 to 255
+static bool read_byte_field(const Napi::Object &object, const char *key,
+                            uint8_t &field) {
+  if (!object.Has(key)) {
+    return true;
+  }
+
+  Napi::Value value = object.Get(key);
+  if (!value.IsNumber()) {
+    return false;
+  }
+  double number = value.As<Napi::Number>();
+  if (!(number >= 0 && number <= 0xFF) || number != std::floor(number)) {
+    return false;
+  }
+  field = static_cast<uint8_t>(number);
+  return true;
+}
+
+// Returns a handle to the sensor, which every other call takes as its first
+// argument; environments that pass the same adaptor share the sensor
 Napi::Object init(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
@@ -16,45 +103,107 @@ Napi::Object init(const Napi::CallbackInfo &info) {
     i2cAdaptor = static_cast<std::string>(info[0].As<Napi::String>());
   }
 
-  int err = BME280_init(i2cAdaptor.c_str());
-  if (err) {
+  int err = NO_ERROR;
+  std::shared_ptr<BME280Device> device = BME280Device::acquire(i2cAdaptor, err);
+  if (!device) {
     return BindingUtils::errFactory(env, err,
       "Could not initialize BME280 module; are you using the right port?");
   }
 
+  return BME280Handle::create(env, device, i2cAdaptor);
+}
+
+Napi::Object deinit(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  {
+    LockedDevice device(info);
+    if (!device) {
+      return device.error();
+    }
+
+    // The sensor is only closed once no other handle is using it; that
+    // happens after the lock is released
+    device.handle()->device.reset();
+  }
+
   Napi::Object returnObject = Napi::Object::New(env);
-  returnObject.Set(Napi::String::New(env, "returnCode"), Napi::Number::New(env, err));
+  returnObject.Set(Napi::String::New(env, "returnCode"), Napi::Number::New(env, NO_ERROR));
   return returnObject;
 }
 
-Napi::Object deinit(const Napi::CallbackInfo &info) {
+Napi::Object measure(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
-  int err = BME280_deinit();
+  double pressure, temperature, humidity;
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_measure(device.dev(), &pressure, &temperature, &humidity);
   if (err) {
     return BindingUtils::errFactory(env, err,
-      "Could not deinitialize BME280 module; are you using the right port?");
+      "Could not measure temperature and pressure from BME280 module; did you run init() first?");
   }
 
+  // Channels the profile skips are left out
+  MeasuredChannels channels = measured_channels(device.dev());
   Napi::Object returnObject = Napi::Object::New(env);
-  returnObject.Set(Napi::String::New(env, "returnCode"), Napi::Number::New(env, err));
+  if (channels.pressure) {
+    returnObject.Set(Napi::String::New(env, "pressure"), Napi::Number::New(env, pressure));
+  }
+  if (channels.temperature) {
+    returnObject.Set(Napi::String::New(env, "temperature"), Napi::Number::New(env, temperature));
+  }
+  if (channels.humidity) {
+    returnObject.Set(Napi::String::New(env, "humidity"), Napi::Number::New(env, humidity));
+  }
+
+  if (device.handle()->derived_metrics) {
+    double samples[CHANNEL_COUNT] = { pressure, temperature, humidity };
+    BME280_derive(samples, 1, device.handle()->elevation);
+    if (channels.humidity) {
+      returnObject.Set(Napi::String::New(env, "dew_point"), Napi::Number::New(env, samples[CHANNEL_DEW_POINT]));
+      returnObject.Set(Napi::String::New(env, "absolute_humidity"), Napi::Number::New(env, samples[CHANNEL_ABSOLUTE_HUMIDITY]));
+    }
+    if (channels.pressure) {
+      returnObject.Set(Napi::String::New(env, "altitude"), Napi::Number::New(env, samples[CHANNEL_ALTITUDE]));
+      returnObject.Set(Napi::String::New(env, "sea_level_pressure"), Napi::Number::New(env, samples[CHANNEL_SEA_LEVEL_PRESSURE]));
+    }
+  }
   return returnObject;
 }
 
-Napi::Object measure(const Napi::CallbackInfo &info) {
+// Returns integers: pressure in Pa * 256, temperature in 0.01 degrees C,
+// and humidity in %RH * 1024
+Napi::Object measure_fixed(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
-  double pressure, temperature, humidity;
-  int err = BME280_measure(&pressure, &temperature, &humidity);
+  struct BME280_fixed fixed;
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_measure_fixed(device.dev(), &fixed);
   if (err) {
     return BindingUtils::errFactory(env, err,
       "Could not measure temperature and pressure from BME280 module; did you run init() first?");
   }
 
+  // Channels the profile skips are left out
+  MeasuredChannels channels = measured_channels(device.dev());
   Napi::Object returnObject = Napi::Object::New(env);
-  returnObject.Set(Napi::String::New(env, "pressure"), Napi::Number::New(env, pressure));
-  returnObject.Set(Napi::String::New(env, "temperature"), Napi::Number::New(env, temperature));
-  returnObject.Set(Napi::String::New(env, "humidity"), Napi::Number::New(env, humidity));
+  if (channels.pressure) {
+    returnObject.Set(Napi::String::New(env, "pressure"), Napi::Number::New(env, fixed.pressure));
+  }
+  if (channels.temperature) {
+    returnObject.Set(Napi::String::New(env, "temperature"), Napi::Number::New(env, fixed.temperature));
+  }
+  if (channels.humidity) {
+    returnObject.Set(Napi::String::New(env, "humidity"), Napi::Number::New(env, fixed.humidity));
+  }
   return returnObject;
 }
 
@@ -62,7 +211,12 @@ Napi::Object get_config(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
   uint8_t standby, filter_coefficient;
-  int err = BME280_get_config(&standby, &filter_coefficient);
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_get_config(device.dev(), &standby, &filter_coefficient);
   if (err) {
     return BindingUtils::errFactory(env, err,
       "Could not get config from BME280 module; did you run init() first?");
@@ -78,7 +232,12 @@ Napi::Object get_ctrl_hum(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
   uint8_t osrs_h;
-  int err = BME280_get_ctrl_hum(&osrs_h);
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_get_ctrl_hum(device.dev(), &osrs_h);
   if (err) {
     return BindingUtils::errFactory(env, err,
       "Could not get humidity controls from BME280 module; did you run init() first?");
@@ -93,7 +252,12 @@ Napi::Object get_ctrl_meas(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
   uint8_t osrs_p, osrs_t, mode;
-  int err = BME280_get_ctrl_meas(&osrs_p, &osrs_t, &mode);
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_get_ctrl_meas(device.dev(), &osrs_p, &osrs_t, &mode);
   if (err) {
     return BindingUtils::errFactory(env, err,
       "Could not get measurement controls from BME280 module; did you run init() first?");
@@ -110,7 +274,12 @@ Napi::Object get_status(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
   uint8_t measuring, im_update;
-  int err = BME280_get_status(&measuring, &im_update);
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_get_status(device.dev(), &measuring, &im_update);
   if (err) {
     return BindingUtils::errFactory(env, err,
       "Could not get status from BME280 module; did you run init() first?");
@@ -123,11 +292,16 @@ Napi::Object get_status(const Napi::CallbackInfo &info) {
 }
 
 Napi::Object set_config(const Napi::CallbackInfo &info) {
-  uint8_t standby = static_cast<uint32_t>(info[0].As<Napi::Number>()) & 0xFF;
-  uint8_t filter_coefficient = static_cast<uint32_t>(info[1].As<Napi::Number>()) & 0xFF;
+  uint8_t standby = static_cast<uint32_t>(info[1].As<Napi::Number>()) & 0xFF;
+  uint8_t filter_coefficient = static_cast<uint32_t>(info[2].As<Napi::Number>()) & 0xFF;
   Napi::Env env = info.Env();
 
-  int err = BME280_set_config(standby, filter_coefficient);
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_set_config(device.dev(), standby, filter_coefficient);
   if (err) {
     return BindingUtils::errFactory(env, err,
       "Could not set config for BME280 module; did you run init() first?");
@@ -139,10 +313,15 @@ Napi::Object set_config(const Napi::CallbackInfo &info) {
 }
 
 Napi::Object set_ctrl_hum(const Napi::CallbackInfo &info) {
-  uint8_t osrs_h = static_cast<uint32_t>(info[0].As<Napi::Number>()) & 0x7;
+  uint8_t osrs_h = static_cast<uint32_t>(info[1].As<Napi::Number>()) & 0x7;
   Napi::Env env = info.Env();
 
-  int err = BME280_set_ctrl_hum(osrs_h);
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_set_ctrl_hum(device.dev(), osrs_h);
   if (err) {
     return BindingUtils::errFactory(env, err,
       "Could not set humidity controls for BME280 module; did you run init() first?");
@@ -154,12 +333,17 @@ Napi::Object set_ctrl_hum(const Napi::CallbackInfo &info) {
 }
 
 Napi::Object set_ctrl_meas(const Napi::CallbackInfo &info) {
-  uint8_t osrs_p = static_cast<uint32_t>(info[0].As<Napi::Number>()) & 0xFF;
-  uint8_t osrs_t = static_cast<uint32_t>(info[1].As<Napi::Number>()) & 0xFF;
-  uint8_t mode = static_cast<uint32_t>(info[2].As<Napi::Number>()) & 0xFF;
+  uint8_t osrs_p = static_cast<uint32_t>(info[1].As<Napi::Number>()) & 0xFF;
+  uint8_t osrs_t = static_cast<uint32_t>(info[2].As<Napi::Number>()) & 0xFF;
+  uint8_t mode = static_cast<uint32_t>(info[3].As<Napi::Number>()) & 0xFF;
   Napi::Env env = info.Env();
 
-  int err = BME280_set_ctrl_meas(osrs_p, osrs_t, mode);
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_set_ctrl_meas(device.dev(), osrs_p, osrs_t, mode);
   if (err) {
     return BindingUtils::errFactory(env, err,
       "Could not set measurement controls from BME280 module; did you run init() first?");
@@ -174,7 +358,12 @@ Napi::Object get_chip_id(const Napi::CallbackInfo &info) {
   Napi::Env env = info.Env();
 
   uint8_t chip_id;
-  int err = BME280_get_chip_id(&chip_id);
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_get_chip_id(device.dev(), &chip_id);
   if (err) {
     return BindingUtils::errFactory(env, err,
       "Could not get word ID from BME280 module; did you run init() first?");
@@ -185,6 +374,272 @@ Napi::Object get_chip_id(const Napi::CallbackInfo &info) {
   return returnObject;
 }
 
+Napi::Object get_profile(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  struct BME280_profile profile;
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  // Served from the cache; no bus access
+  BME280_get_profile(device.dev(), &profile);
+
+  Napi::Object returnObject = Napi::Object::New(env);
+  returnObject.Set(Napi::String::New(env, "name"), Napi::String::New(env, profile_name(profile)));
+  returnObject.Set(Napi::String::New(env, "osrs_h"), Napi::Number::New(env, profile.osrs_h));
+  returnObject.Set(Napi::String::New(env, "osrs_t"), Napi::Number::New(env, profile.osrs_t));
+  returnObject.Set(Napi::String::New(env, "osrs_p"), Napi::Number::New(env, profile.osrs_p));
+  returnObject.Set(Napi::String::New(env, "mode"), Napi::Number::New(env, profile.mode));
+  returnObject.Set(Napi::String::New(env, "standby"), Napi::Number::New(env, profile.standby));
+  returnObject.Set(Napi::String::New(env, "filter_coefficient"), Napi::Number::New(env, profile.filter_coefficient));
+  return returnObject;
+}
+
+// Takes either the name of a preset, or an object with any of the fields
+// returned by getProfile(); fields that are left out keep their current value
+Napi::Object set_profile(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  struct BME280_profile profile;
+  BME280_get_profile(device.dev(), &profile);
+
+  if (info.Length() >= 2 && info[1].IsString()) {
+    std::string name = static_cast<std::string>(info[1].As<Napi::String>());
+    int preset = 0;
+    while (preset < PRESET_COUNT && name != preset_names[preset]) {
+      preset++;
+    }
+    if (preset == PRESET_COUNT) {
+      return BindingUtils::errFactory(env, ERROR_INVAL,
+        "Unknown profile; expected weatherMonitoring, humiditySensing, indoorNavigation or gaming");
+    }
+    BME280_get_preset(static_cast<enum Preset>(preset), &profile);
+  } else if (info.Length() >= 2 && info[1].IsObject()) {
+    Napi::Object custom = info[1].As<Napi::Object>();
+    if (!read_byte_field(custom, "osrs_h", profile.osrs_h) ||
+        !read_byte_field(custom, "osrs_t", profile.osrs_t) ||
+        !read_byte_field(custom, "osrs_p", profile.osrs_p) ||
+        !read_byte_field(custom, "mode", profile.mode) ||
+        !read_byte_field(custom, "standby", profile.standby) ||
+        !read_byte_field(custom, "filter_coefficient", profile.filter_coefficient)) {
+      return BindingUtils::errFactory(env, ERROR_INVAL,
+        "Profile settings must be register values from bme280.h");
+    }
+  } else {
+    return BindingUtils::errFactory(env, ERROR_INVAL,
+      "Expected the name of a profile, or an object with profile settings");
+  }
+
+  int err = BME280_set_profile(device.dev(), &profile);
+  if (err) {
+    return BindingUtils::errFactory(env, err,
+      "Could not set profile for BME280 module; are the settings valid?");
+  }
+
+  Napi::Object returnObject = Napi::Object::New(env);
+  returnObject.Set(Napi::String::New(env, "returnCode"), Napi::Number::New(env, err));
+  return returnObject;
+}
+
+Napi::Object get_software_filter(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  struct BME280_sw_filter_config config;
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  BME280_get_sw_filter(device.dev(), &config);
+
+  Napi::Object returnObject = Napi::Object::New(env);
+  returnObject.Set(Napi::String::New(env, "hampel"), Napi::Number::New(env, config.hampel));
+  returnObject.Set(Napi::String::New(env, "hampel_threshold"), Napi::Number::New(env,
+    static_cast<double>(config.hampel_threshold) / SW_FILTER_THRESHOLD_ONE));
+  returnObject.Set(Napi::String::New(env, "median"), Napi::Number::New(env, config.median));
+  returnObject.Set(Napi::String::New(env, "decimation"), Napi::Number::New(env, config.decimation));
+  return returnObject;
+}
+
+// Takes an object with any of the fields returned by getSoftwareFilter();
+// fields that are left out keep their current value
+Napi::Object set_software_filter(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[1].IsObject()) {
+    return BindingUtils::errFactory(env, ERROR_INVAL,
+      "Expected an object with software filter settings");
+  }
+
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  struct BME280_sw_filter_config config;
+  BME280_get_sw_filter(device.dev(), &config);
+
+  Napi::Object settings = info[1].As<Napi::Object>();
+  if (!read_byte_field(settings, "hampel", config.hampel) ||
+      !read_byte_field(settings, "median", config.median) ||
+      !read_byte_field(settings, "decimation", config.decimation)) {
+    return BindingUtils::errFactory(env, ERROR_INVAL,
+      "Software filter windows and decimation must be whole numbers");
+  }
+  if (settings.Has("hampel_threshold")) {
+    // Stored in fixed point; the largest threshold that fits is about 64
+    Napi::Value value = settings.Get("hampel_threshold");
+    if (!value.IsNumber()) {
+      return BindingUtils::errFactory(env, ERROR_INVAL,
+        "Hampel threshold must be a number above 0 and below 64");
+    }
+    double threshold = value.As<Napi::Number>();
+    double scaled = std::round(threshold * SW_FILTER_THRESHOLD_ONE);
+    if (!(scaled >= 1 && scaled <= UINT16_MAX)) {
+      return BindingUtils::errFactory(env, ERROR_INVAL,
+        "Hampel threshold must be a number above 0 and below 64");
+    }
+    config.hampel_threshold = static_cast<uint16_t>(scaled);
+  }
+
+  int err = BME280_set_sw_filter(device.dev(), &config);
+  if (err) {
+    return BindingUtils::errFactory(env, err,
+      "Could not set software filter for BME280 module; windows can be at most 15 samples, and decimation at most 16");
+  }
+
+  Napi::Object returnObject = Napi::Object::New(env);
+  returnObject.Set(Napi::String::New(env, "returnCode"), Napi::Number::New(env, err));
+  return returnObject;
+}
+
+Napi::Object get_compensation(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  enum Compensation compensation;
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  BME280_get_compensation(device.dev(), &compensation);
+
+  Napi::Object returnObject = Napi::Object::New(env);
+  returnObject.Set(Napi::String::New(env, "compensation"), Napi::String::New(env, compensation_names[compensation]));
+  return returnObject;
+}
+
+// Takes "int64" (the datasheet's reference), "int32" or "float"
+Napi::Object set_compensation(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  std::string name;
+  if (info.Length() >= 2 && info[1].IsString()) {
+    name = static_cast<std::string>(info[1].As<Napi::String>());
+  }
+
+  int compensation = 0;
+  while (compensation <= COMPENSATION_FLOAT && name != compensation_names[compensation]) {
+    compensation++;
+  }
+  if (compensation > COMPENSATION_FLOAT) {
+    return BindingUtils::errFactory(env, ERROR_INVAL,
+      "Unknown compensation; expected int64, int32 or float");
+  }
+
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  int err = BME280_set_compensation(device.dev(), static_cast<enum Compensation>(compensation));
+  if (err) {
+    return BindingUtils::errFactory(env, err,
+      "Could not set compensation for BME280 module");
+  }
+
+  Napi::Object returnObject = Napi::Object::New(env);
+  returnObject.Set(Napi::String::New(env, "returnCode"), Napi::Number::New(env, err));
+  return returnObject;
+}
+
+// Takes the station elevation in metres to make measure() also return dew
+// point, absolute humidity, altitude and sea level pressure; with no
+// elevation, measure() goes back to returning only measured values
+Napi::Object set_derived_metrics(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  LockedDevice device(info);
+  if (!device) {
+    return device.error();
+  }
+
+  if (info.Length() >= 2 && info[1].IsNumber()) {
+    double elevation = info[1].As<Napi::Number>();
+    if (!valid_elevation(elevation)) {
+      return BindingUtils::errFactory(env, ERROR_INVAL,
+        "Could not enable derived metrics; is the elevation in metres?");
+    }
+    device.handle()->derived_metrics = true;
+    device.handle()->elevation = elevation;
+  } else {
+    device.handle()->derived_metrics = false;
+  }
+
+  Napi::Object returnObject = Napi::Object::New(env);
+  returnObject.Set(Napi::String::New(env, "returnCode"), Napi::Number::New(env, NO_ERROR));
+  return returnObject;
+}
+
+// Fills in the derived channels of a Float64Array laid out as in derived.h,
+// i.e. every pressure, then every temperature, then every humidity, and so
+// on; elevation is in metres and defaults to sea level
+Napi::Object derive(const Napi::CallbackInfo &info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsTypedArray() ||
+      info[0].As<Napi::TypedArray>().TypedArrayType() != napi_float64_array) {
+    return BindingUtils::errFactory(env, ERROR_INVAL,
+      "Expected a Float64Array of samples");
+  }
+
+  Napi::Float64Array buffer = info[0].As<Napi::Float64Array>();
+  if (buffer.ElementLength() % CHANNEL_COUNT) {
+    return BindingUtils::errFactory(env, ERROR_INVAL,
+      "Sample buffer length must be a multiple of the number of channels");
+  }
+
+  double elevation = 0;
+  if (info.Length() >= 2 && !info[1].IsUndefined()) {
+    if (!info[1].IsNumber()) {
+      return BindingUtils::errFactory(env, ERROR_INVAL,
+        "Could not compute derived metrics; is the elevation in metres?");
+    }
+    elevation = info[1].As<Napi::Number>();
+  }
+  if (!valid_elevation(elevation)) {
+    return BindingUtils::errFactory(env, ERROR_INVAL,
+      "Could not compute derived metrics; is the elevation in metres?");
+  }
+
+  int err = BME280_derive(buffer.Data(), buffer.ElementLength() / CHANNEL_COUNT, elevation);
+  if (err) {
+    return BindingUtils::errFactory(env, err,
+      "Could not compute derived metrics; is the elevation in metres?");
+  }
+
+  Napi::Object returnObject = Napi::Object::New(env);
+  returnObject.Set(Napi::String::New(env, "returnCode"), Napi::Number::New(env, err));
+  return returnObject;
+}
+
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
   exports.Set(Napi::String::New(env, "init"),
               Napi::Function::New(env, init));
@@ -192,18 +647,46 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
               Napi::Function::New(env, deinit));
   exports.Set(Napi::String::New(env, "measure"),
               Napi::Function::New(env, measure));
+  exports.Set(Napi::String::New(env, "measureFixed"),
+              Napi::Function::New(env, measure_fixed));
   exports.Set(Napi::String::New(env, "getConfig"),
               Napi::Function::New(env, get_config));
+  exports.Set(Napi::String::New(env, "getCtrlHum"),
+              Napi::Function::New(env, get_ctrl_hum));
   exports.Set(Napi::String::New(env, "getCtrlMeas"),
               Napi::Function::New(env, get_ctrl_meas));
   exports.Set(Napi::String::New(env, "getStatus"),
               Napi::Function::New(env, get_status));
   exports.Set(Napi::String::New(env, "setConfig"),
               Napi::Function::New(env, set_config));
+  exports.Set(Napi::String::New(env, "setCtrlHum"),
+              Napi::Function::New(env, set_ctrl_hum));
   exports.Set(Napi::String::New(env, "setCtrlMeas"),
-              Napi::Function::New(env, get_ctrl_meas));
+              Napi::Function::New(env, set_ctrl_meas));
   exports.Set(Napi::String::New(env, "getChipID"),
               Napi::Function::New(env, get_chip_id));
+  exports.Set(Napi::String::New(env, "getProfile"),
+              Napi::Function::New(env, get_profile));
+  exports.Set(Napi::String::New(env, "setProfile"),
+              Napi::Function::New(env, set_profile));
+  exports.Set(Napi::String::New(env, "getSoftwareFilter"),
+              Napi::Function::New(env, get_software_filter));
+  exports.Set(Napi::String::New(env, "setSoftwareFilter"),
+              Napi::Function::New(env, set_software_filter));
+  exports.Set(Napi::String::New(env, "getCompensation"),
+              Napi::Function::New(env, get_compensation));
+  exports.Set(Napi::String::New(env, "setCompensation"),
+              Napi::Function::New(env, set_compensation));
+  exports.Set(Napi::String::New(env, "setDerivedMetrics"),
+              Napi::Function::New(env, set_derived_metrics));
+  exports.Set(Napi::String::New(env, "derive"),
+              Napi::Function::New(env, derive));
+  exports.Set(Napi::String::New(env, "channelCount"),
+              Napi::Number::New(env, CHANNEL_COUNT));
+
+  AddonData *data = new AddonData();
+  data->handle_constructor = Napi::Persistent(BME280Handle::define(env));
+  env.SetInstanceData(data);
   return exports;
 }
 
@@ -0,0 +1,34 @@
+#include "bme280_device.h"
+
+std::mutex BME280Device::registry_lock_;
+std::map<std::string, std::weak_ptr<BME280Device>> BME280Device::registry_;
+
+BME280Device::BME280Device() {
+  dev.i2c_fd = -1;
+}
+
+BME280Device::~BME280Device() {
+  BME280_deinit(&dev);
+}
+
+std::shared_ptr<BME280Device> BME280Device::acquire(const std::string &i2c_adaptor,
+                                                    int &err) {
+  std::lock_guard<std::mutex> registry_guard(registry_lock_);
+
+  std::shared_ptr<BME280Device> device = registry_[i2c_adaptor].lock();
+  if (device) {
+    err = NO_ERROR;
+    return device;
+  }
+
+  // Nobody holds this adaptor (or the last holder already released it)
+  device = std::shared_ptr<BME280Device>(new BME280Device());
+  err = BME280_init(&device->dev, i2c_adaptor.c_str());
+  if (err) {
+    registry_.erase(i2c_adaptor);
+    return nullptr;
+  }
+
+  registry_[i2c_adaptor] = device;
+  return device;
+}
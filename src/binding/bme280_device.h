@@ -0,0 +1,39 @@
+#ifndef BME280_DEVICE
+#define BME280_DEVICE
+
+extern "C" {
+#include "bme280.h"
+}
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// A BME280 shared by every Node.js environment (the main thread and any
+// worker_threads) that opened the same I2C adaptor. The sensor is opened by
+// the first environment to acquire it and closed when the last one releases it.
+class BME280Device {
+ public:
+  // Returns the device for i2c_adaptor, opening it if nothing holds it yet;
+  // on failure, returns nullptr and sets err to the BME280 error code
+  static std::shared_ptr<BME280Device> acquire(const std::string &i2c_adaptor,
+                                               int &err);
+
+  ~BME280Device();
+
+  BME280Device(const BME280Device &) = delete;
+  BME280Device &operator=(const BME280Device &) = delete;
+
+  // Must be held for every call that touches dev
+  std::mutex lock;
+  struct BME280_dev dev;
+
+ private:
+  BME280Device();
+
+  static std::mutex registry_lock_;
+  static std::map<std::string, std::weak_ptr<BME280Device>> registry_;
+};
+
+#endif
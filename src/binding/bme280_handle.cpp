@@ -0,0 +1,45 @@
+#include "bme280_handle.h"
+
+#include "binding_utils.h"
+
+Napi::Function BME280Handle::define(Napi::Env env) {
+  return DefineClass(env, "BME280Device", {});
+}
+
+Napi::Object BME280Handle::create(Napi::Env env,
+                                  std::shared_ptr<BME280Device> device,
+                                  const std::string &i2c_adaptor) {
+  Napi::Object object = env.GetInstanceData<AddonData>()->handle_constructor.New({});
+  BME280Handle::Unwrap(object)->device = device;
+  object.Set(Napi::String::New(env, "adaptor"), Napi::String::New(env, i2c_adaptor));
+  return object;
+}
+
+BME280Handle::BME280Handle(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<BME280Handle>(info) {}
+
+LockedDevice::LockedDevice(const Napi::CallbackInfo &info) : env_(info.Env()) {
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    return;
+  }
+
+  Napi::Object object = info[0].As<Napi::Object>();
+  AddonData *data = env_.GetInstanceData<AddonData>();
+  if (!object.InstanceOf(data->handle_constructor.Value())) {
+    return;
+  }
+
+  BME280Handle *handle = BME280Handle::Unwrap(object);
+  if (!handle->device) {
+    return;
+  }
+
+  device_ = handle->device;
+  lock_ = std::unique_lock<std::mutex>(device_->lock);
+  handle_ = handle;
+}
+
+Napi::Object LockedDevice::error() const {
+  return BindingUtils::errFactory(env_, ERROR_DEVICE,
+    "Expected a BME280 device that is still open; pass the object returned by init()");
+}
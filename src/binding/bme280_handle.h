@@ -0,0 +1,61 @@
+#ifndef BME280_HANDLE
+#define BME280_HANDLE
+
+extern "C" {
+#include "bme280.h"
+}
+
+#include "bme280_device.h"
+
+#include <napi.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Per-environment state; each worker_thread that loads the addon gets its own
+// copy, which is freed when it exits
+struct AddonData {
+  Napi::FunctionReference handle_constructor;
+};
+
+// The object init() returns, which every other call takes as its first
+// argument. Handles belong to the environment that created them; another
+// worker gets a handle to the same sensor by calling init() with the
+// handle's adaptor property.
+class BME280Handle : public Napi::ObjectWrap<BME280Handle> {
+ public:
+  static Napi::Function define(Napi::Env env);
+  static Napi::Object create(Napi::Env env,
+                             std::shared_ptr<BME280Device> device,
+                             const std::string &i2c_adaptor);
+
+  explicit BME280Handle(const Napi::CallbackInfo &info);
+
+  std::shared_ptr<BME280Device> device;  // Empty after deinit()
+  bool derived_metrics = false;          // Whether measure() adds derived channels
+  double elevation = 0;                  // Station elevation in metres
+};
+
+// Unwraps the handle passed as a binding's first argument, and holds its
+// device's lock for as long as this is in scope
+class LockedDevice {
+ public:
+  explicit LockedDevice(const Napi::CallbackInfo &info);
+
+  explicit operator bool() const { return handle_ != nullptr; }
+
+  // Error object to return to Javascript when this is false
+  Napi::Object error() const;
+
+  struct BME280_dev *dev() { return &device_->dev; }
+  BME280Handle *handle() { return handle_; }
+
+ private:
+  Napi::Env env_;
+  BME280Handle *handle_ = nullptr;
+  std::shared_ptr<BME280Device> device_;
+  std::unique_lock<std::mutex> lock_;
+};
+
+#endif
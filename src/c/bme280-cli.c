@@ -1,31 +1,106 @@
 #include "bme280.h"
+#include "compensate.h"
+#include "derived.h"
 
+#include <string.h>
 #include <unistd.h>
 
+// Worked example from the datasheet, for checking without a chip attached;
+// the humidity values are typical of real parts, as the datasheet has none
+static const struct BME280_calib example_calib = {
+  27504, 26435, -1000,
+  36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000,
+  75, 0, 362, 313, 50, 30
+};
+
+// Cross-checks each compensation variant against the 64-bit reference;
+// returns non-zero if any is out of tolerance
+static int check_compensation(const struct BME280_calib *calib) {
+  struct {
+    enum Compensation variant;
+    const char *name;
+    struct BME280_deviation tolerance;
+  } variants[] = {
+    // Whole pascals, and the datasheet's coarser 32-bit pressure formula
+    { COMPENSATION_INT32, "int32", { 8.0, 0.0, 0.0 } },
+    { COMPENSATION_FLOAT, "float", { 2.0, 0.02, 0.05 } }
+  };
+
+  int failed = 0;
+  for (int i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+    struct BME280_deviation max;
+    int rv = BME280_compare_compensation(calib, variants[i].variant, &max);
+    int ok = !rv &&
+             max.pressure <= variants[i].tolerance.pressure &&
+             max.temperature <= variants[i].tolerance.temperature &&
+             max.humidity <= variants[i].tolerance.humidity;
+    printf("%s: max deviation Pressure: %f, Temperature: %f, Humidity: %f, %s\n",
+           variants[i].name, max.pressure, max.temperature, max.humidity,
+           ok ? "OK" : "FAILED");
+    failed |= !ok;
+  }
+  return failed;
+}
+
 int main(int argc, char **argv) {
-  int rv = BME280_init("/dev/i2c-4");
+  struct BME280_dev dev;
+  int rv = BME280_init(&dev, "/dev/i2c-4");
   if (rv) {
     printf("Failed to init BME280\n");
   }
 
+  // Uses the chip's calibration when there is one
+  if (argc > 1 && !strcmp(argv[1], "check")) {
+    if (rv) {
+      printf("Using the datasheet's example calibration\n");
+      return check_compensation(&example_calib);
+    }
+    rv = check_compensation(&dev.calib);
+    BME280_deinit(&dev);
+    return rv;
+  }
+  if (rv) {
+    return rv;
+  }
+
   uint8_t standby, coefficient;
-  BME280_get_config(&standby, &coefficient);
+  BME280_get_config(&dev, &standby, &coefficient);
   printf("Standby: 0x%x, Coefficient: 0x%x\n", standby, coefficient);
 
   uint8_t osrs_p, osrs_t, mode;
-  BME280_get_ctrl_meas(&osrs_p, &osrs_t, &mode);
+  BME280_get_ctrl_meas(&dev, &osrs_p, &osrs_t, &mode);
   printf("osrs_p: 0x%x, osrs_t: 0x%x, mode: 0x%x\n", osrs_p, osrs_t, mode);
 
   uint8_t osrs_h;
-  BME280_get_ctrl_hum(&osrs_h);
+  BME280_get_ctrl_hum(&dev, &osrs_h);
   printf("osrs_h: 0x%x\n", osrs_h);
 
   for (int counter = 0; counter < 60; counter++) {
+    // Both outputs come from the same conversion
+    struct BME280_raw raw;
     double pressure, temperature, humidity;
-    int rv = BME280_measure(&pressure, &temperature, &humidity);
+    struct BME280_fixed fixed;
+    int rv = BME280_read_raw(&dev, &raw);
+    rv = rv ? rv : BME280_compensate(&dev.calib, dev.compensation, &raw,
+                                     &pressure, &temperature, &humidity);
+    rv = rv ? rv : BME280_compensate_fixed(&dev.calib, dev.compensation, &raw, &fixed);
+    if (rv) {
+      printf("Failed to measure, rv: %d\n", rv);
+      usleep(1000000);
+      continue;
+    }
     printf("Temperature: %f, Pressure: %f, Humidity: %f, rv: %d\n", temperature, pressure, humidity, rv);
+
+    double derived[CHANNEL_COUNT] = { pressure, temperature, humidity };
+    BME280_derive(derived, 1, 0);
+    printf("Dew point: %f, Absolute humidity: %f, Altitude: %f\n",
+           derived[CHANNEL_DEW_POINT], derived[CHANNEL_ABSOLUTE_HUMIDITY],
+           derived[CHANNEL_ALTITUDE]);
+
+    printf("Fixed point: Temperature: %d, Pressure: %u, Humidity: %u\n",
+           fixed.temperature, fixed.pressure, fixed.humidity);
     usleep(1000000);
   }
 
-  BME280_deinit();
+  BME280_deinit(&dev);
 }
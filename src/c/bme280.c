@@ -1,4 +1,5 @@
 #include "bme280.h"
+#include "compensate.h"
 
 #include <fcntl.h>
 #include <linux/i2c-dev.h>
@@ -8,29 +9,29 @@
 #include <stdlib.h>
 #include <string.h>
 
-static int i2c_fd;
-
-// Constants for compensation, unique to each chip
-static uint16_t dig_T1;
-static int16_t dig_T2, dig_T3;
-static uint16_t dig_P1;
-static int16_t dig_P2, dig_P3, dig_P4, dig_P5, dig_P6, dig_P7, dig_P8, dig_P9;
-static uint8_t dig_H1, dig_H3;
-static int16_t dig_H2, dig_H4, dig_H5;
-static int8_t dig_H6;
-
-static int32_t t_fine;
+// Recommended settings from section 3.5 of the datasheet, indexed by Preset.
+// Standby is unused in forced mode, so it is left at its reset value.
+static const struct BME280_profile presets[PRESET_COUNT] = {
+  // Weather monitoring: one forced measurement per minute, no filtering
+  { H_OVERSAMPLE_1, T_OVERSAMPLE_1, P_OVERSAMPLE_1, FORCED, MS0_5, FILTER_0 },
+  // Humidity sensing: one forced measurement per second, pressure skipped
+  { H_OVERSAMPLE_1, T_OVERSAMPLE_1, P_OVERSAMPLE_SKIP, FORCED, MS0_5, FILTER_0 },
+  // Indoor navigation: continuous, heavily oversampled and filtered pressure
+  { H_OVERSAMPLE_1, T_OVERSAMPLE_2, P_OVERSAMPLE_16, NORMAL, MS0_5, FILTER_16 },
+  // Gaming: continuous, fast pressure; humidity skipped
+  { H_OVERSAMPLE_SKIP, T_OVERSAMPLE_1, P_OVERSAMPLE_4, NORMAL, MS0_5, FILTER_16 }
+};
 
 static int read_bytes(int fd, uint8_t reg, uint8_t *rx_buf, int len) {
   memset(rx_buf, 0, len);
 
   uint8_t tx[1];
   tx[0] = reg;
-  if (write(i2c_fd, tx, 1) != 1) {
+  if (write(fd, tx, 1) != 1) {
     return ERROR_I2C;
   }
 
-  return (!(read(i2c_fd, rx_buf, len) == len));
+  return (!(read(fd, rx_buf, len) == len));
 }
 
 static int write_bytes(int fd, uint8_t reg, uint8_t *tx_buf, int len) {
@@ -38,137 +39,127 @@ static int write_bytes(int fd, uint8_t reg, uint8_t *tx_buf, int len) {
   tx[0] = reg;
   memcpy(&tx[1], tx_buf, len);
 
-  return (!(write(i2c_fd, tx, len+1) == len+1));
+  return (!(write(fd, tx, len+1) == len+1));
+}
+
+// Writes several registers in one transaction; tx_buf holds
+// (register, value) pairs, which the chip applies in order
+static int write_pairs(int fd, const uint8_t *tx_buf, int len) {
+  return (!(write(fd, tx_buf, len) == len));
+}
+
+static int profile_is_valid(const struct BME280_profile *profile) {
+  return profile->osrs_h <= H_OVERSAMPLE_16 &&
+         !(profile->osrs_t & ~0xE0) && profile->osrs_t <= T_OVERSAMPLE_16 &&
+         !(profile->osrs_p & ~0x1C) && profile->osrs_p <= P_OVERSAMPLE_16 &&
+         (profile->mode == SLEEP || profile->mode == FORCED ||
+          profile->mode == NORMAL) &&
+         !(profile->standby & ~0xE0) &&
+         !(profile->filter_coefficient & ~0x1C) &&
+         profile->filter_coefficient <= FILTER_16;
+}
+
+// In forced mode, the chip only converts when ctrl_meas is written, then
+// returns to sleep; wait for the conversion so measure() reads fresh data
+static int trigger_forced_measurement(struct BME280_dev *dev) {
+  uint8_t ctrl_meas_tx = dev->profile.osrs_t | dev->profile.osrs_p | FORCED;
+  int rv = write_bytes(dev->i2c_fd, BME280_CTRL_MEAS_REG, &ctrl_meas_tx, 1);
+  if (rv) {
+    return ERROR_I2C;
+  }
+
+  // Longest conversion (everything oversampled x16) is about 113ms
+  for (int tries = 0; tries < 120; tries++) {
+    usleep(1000);
+    uint8_t measuring, im_update;
+    rv = BME280_get_status(dev, &measuring, &im_update);
+    if (rv) {
+      return rv;
+    }
+    if (!measuring) {
+      return NO_ERROR;
+    }
+  }
+
+  debug_print(stderr, "%s\n", "Timed out waiting for forced measurement");
+  return ERROR_DEVICE;
 }
 
 // Calibration data is unique to each chip and must be read
 // after startup so compensation for temperature and pressure
 // can be applied.
-static int read_calibration(void) {
+static int read_calibration(int fd, struct BME280_calib *calib) {
   uint8_t t1[2], t2[2], t3[2];
   uint8_t p1[2], p2[2], p3[2], p4[2], p5[2], p6[2], p7[2], p8[2], p9[2];
   uint8_t h1[1], h2[2], h3[1], h4[2], h5[2], h6[1];
 
   int rv = 0;
-  rv |= read_bytes(i2c_fd, BME280_DIG_T1_REG, t1, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_T2_REG, t2, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_T3_REG, t3, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_P1_REG, p1, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_P2_REG, p2, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_P3_REG, p3, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_P4_REG, p4, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_P5_REG, p5, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_P6_REG, p6, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_P7_REG, p7, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_P8_REG, p8, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_P9_REG, p9, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_H1_REG, h1, 1);
-  rv |= read_bytes(i2c_fd, BME280_DIG_H2_REG, h2, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_H3_REG, h3, 1);
-  rv |= read_bytes(i2c_fd, BME280_DIG_H4_REG, h4, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_H5_REG, h5, 2);
-  rv |= read_bytes(i2c_fd, BME280_DIG_H6_REG, h6, 1);
-
-  dig_T1 = (t1[1] << 8 | t1[0]) & 0xFFFF;
-  dig_T2 = (t2[1] << 8 | t2[0]) & 0xFFFF;
-  dig_T3 = (t3[1] << 8 | t3[0]) & 0xFFFF;
-  dig_P1 = (p1[1] << 8 | p1[0]) & 0xFFFF;
-  dig_P2 = (p2[1] << 8 | p2[0]) & 0xFFFF;
-  dig_P3 = (p3[1] << 8 | p3[0]) & 0xFFFF;
-  dig_P4 = (p4[1] << 8 | p4[0]) & 0xFFFF;
-  dig_P5 = (p5[1] << 8 | p5[0]) & 0xFFFF;
-  dig_P6 = (p6[1] << 8 | p6[0]) & 0xFFFF;
-  dig_P7 = (p7[1] << 8 | p7[0]) & 0xFFFF;
-  dig_P8 = (p8[1] << 8 | p8[0]) & 0xFFFF;
-  dig_P9 = (p9[1] << 8 | p9[0]) & 0xFFFF;
-  dig_H1 = h1[0] & 0xFF;
-  dig_H2 = (h2[1] << 8 | h2[0]) & 0xFFFF;
-  dig_H3 = h3[0] & 0xFF;
-  dig_H4 = (h4[0] << 4 | (h4[1] & 0xF)) & 0xFFFF;
-  dig_H5 = (h5[1] << 4 | h5[0] >> 4) & 0xFFFF;
-  dig_H6 = h6[0] & 0xFF;
-
-  debug_print(stdout, "0x%x, 0x%x, 0x%x\n", dig_T1, dig_T2, dig_T3);
+  rv |= read_bytes(fd, BME280_DIG_T1_REG, t1, 2);
+  rv |= read_bytes(fd, BME280_DIG_T2_REG, t2, 2);
+  rv |= read_bytes(fd, BME280_DIG_T3_REG, t3, 2);
+  rv |= read_bytes(fd, BME280_DIG_P1_REG, p1, 2);
+  rv |= read_bytes(fd, BME280_DIG_P2_REG, p2, 2);
+  rv |= read_bytes(fd, BME280_DIG_P3_REG, p3, 2);
+  rv |= read_bytes(fd, BME280_DIG_P4_REG, p4, 2);
+  rv |= read_bytes(fd, BME280_DIG_P5_REG, p5, 2);
+  rv |= read_bytes(fd, BME280_DIG_P6_REG, p6, 2);
+  rv |= read_bytes(fd, BME280_DIG_P7_REG, p7, 2);
+  rv |= read_bytes(fd, BME280_DIG_P8_REG, p8, 2);
+  rv |= read_bytes(fd, BME280_DIG_P9_REG, p9, 2);
+  rv |= read_bytes(fd, BME280_DIG_H1_REG, h1, 1);
+  rv |= read_bytes(fd, BME280_DIG_H2_REG, h2, 2);
+  rv |= read_bytes(fd, BME280_DIG_H3_REG, h3, 1);
+  rv |= read_bytes(fd, BME280_DIG_H4_REG, h4, 2);
+  rv |= read_bytes(fd, BME280_DIG_H5_REG, h5, 2);
+  rv |= read_bytes(fd, BME280_DIG_H6_REG, h6, 1);
+
+  calib->dig_T1 = (t1[1] << 8 | t1[0]) & 0xFFFF;
+  calib->dig_T2 = (t2[1] << 8 | t2[0]) & 0xFFFF;
+  calib->dig_T3 = (t3[1] << 8 | t3[0]) & 0xFFFF;
+  calib->dig_P1 = (p1[1] << 8 | p1[0]) & 0xFFFF;
+  calib->dig_P2 = (p2[1] << 8 | p2[0]) & 0xFFFF;
+  calib->dig_P3 = (p3[1] << 8 | p3[0]) & 0xFFFF;
+  calib->dig_P4 = (p4[1] << 8 | p4[0]) & 0xFFFF;
+  calib->dig_P5 = (p5[1] << 8 | p5[0]) & 0xFFFF;
+  calib->dig_P6 = (p6[1] << 8 | p6[0]) & 0xFFFF;
+  calib->dig_P7 = (p7[1] << 8 | p7[0]) & 0xFFFF;
+  calib->dig_P8 = (p8[1] << 8 | p8[0]) & 0xFFFF;
+  calib->dig_P9 = (p9[1] << 8 | p9[0]) & 0xFFFF;
+  calib->dig_H1 = h1[0] & 0xFF;
+  calib->dig_H2 = (h2[1] << 8 | h2[0]) & 0xFFFF;
+  calib->dig_H3 = h3[0] & 0xFF;
+  calib->dig_H4 = (h4[0] << 4 | (h4[1] & 0xF)) & 0xFFFF;
+  calib->dig_H5 = (h5[1] << 4 | h5[0] >> 4) & 0xFFFF;
+  calib->dig_H6 = h6[0] & 0xFF;
+
+  debug_print(stdout, "0x%x, 0x%x, 0x%x\n",
+      calib->dig_T1, calib->dig_T2, calib->dig_T3);
   debug_print(stdout, "0x%x, 0x%x, 0x%x, 0x%x, 0x%x, 0x%x, 0x%x, 0x%x, 0x%x\n",
-      dig_P1, dig_P2, dig_P3, dig_P4, dig_P5, dig_P6, dig_P7, dig_P8, dig_P9);
+      calib->dig_P1, calib->dig_P2, calib->dig_P3, calib->dig_P4, calib->dig_P5,
+      calib->dig_P6, calib->dig_P7, calib->dig_P8, calib->dig_P9);
   debug_print(stdout, "0x%x, 0x%x, 0x%x, 0x%x, 0x%x, 0x%x\n",
-      dig_H1, dig_H2, dig_H3, dig_H4, dig_H5, dig_H6);
+      calib->dig_H1, calib->dig_H2, calib->dig_H3,
+      calib->dig_H4, calib->dig_H5, calib->dig_H6);
   return rv;
 }
 
-// From the datasheet
-static int compensate_pressure(int32_t p_in, double *p_out) {
-  int64_t var1, var2, p;
-  var1 = ((int64_t)t_fine) - 128000;
-  var2 = var1 * var1 * (int64_t)dig_P6;
-  var2 = var2 + ((var1 * (int64_t)dig_P5) << 17);
-  var2 = var2 + (((int64_t)dig_P4) << 35);
-  var1 = ((var1 * var1 * (int64_t)dig_P3) >> 8) + ((var1 * (int64_t)dig_P2) << 12);
-  var1 = ((((int64_t)1) << 47) + var1) * ((int64_t)dig_P1) >> 33;
-
-  if (!var1) {
-    debug_print(stdout, "%s\n", "Pressure compensation: var1 == 0");
-    return 0;
-  }
-  
-  p = 1048576 - p_in;
-  p = (((p << 31) - var2) * 3125) / var1;
-  var1 = (((int64_t)dig_P9) * (p >> 13) * (p >> 13)) >> 25;
-  var2 = (((int64_t)dig_P8) * p) >> 19;
-  p = ((p + var1 + var2) >> 8) + (((int64_t)dig_P7) << 4);
-  *p_out = (double)((uint32_t)p / 256.0);
-
-  return NO_ERROR;
-}
-
-// Also from the datasheet
-static int compensate_temperature(int32_t t_in, double *t_out) {
-  int32_t var1, var2, temperature;
-
-  var1 = ((((t_in >> 3) - ((int32_t)dig_T1 << 1))) * ((int32_t)dig_T2)) >> 11;
-  var2 = ((((t_in >> 4) - ((int32_t)dig_T1)) * ((t_in >> 4) - ((int32_t)dig_T1))) >> 12 *
-      ((int32_t)dig_T3)) >> 14;
-  t_fine = var1 + var2;
-  temperature = (t_fine * 5 + 128) >> 8;
-  *t_out = temperature / 100.0;
-
-  return NO_ERROR;
-}
-
-static int compensate_humidity(int32_t h_in, double *h_out) {
-  int32_t var1;
-  uint32_t humidity;
-
-  var1 = (t_fine - ((int32_t)76800));
-  var1 = (((((h_in << 14) - (((int32_t)dig_H4) << 20) - (((int32_t)dig_H5) *
-      var1)) + ((int32_t)16384)) >> 15) * (((((((var1 *
-      ((int32_t)dig_H6)) >> 10) * (((var1 * ((int32_t)dig_H3)) >> 11) +
-      ((int32_t)32768))) >> 10) + ((int32_t)2097152)) * ((int32_t)dig_H2) +
-      8192) >> 14));
-  var1 = (var1 - (((((var1 >> 15) * (var1 >> 15)) >> 7) * ((uint32_t)dig_H1)) >> 4));
-  var1 = (var1 < 0 ? 0 : var1);
-  var1 = (var1 > 419430400 ? 419430400 : var1); 
-  humidity = (uint32_t)(var1 >> 12);
-  *h_out = humidity / 1024.0;
-
-  return NO_ERROR;
-}
-
-int BME280_init(const char *i2c_adaptor) {
-  i2c_fd = open(i2c_adaptor, O_RDWR);
-  if (i2c_fd < 0) {
+int BME280_init(struct BME280_dev *dev, const char *i2c_adaptor) {
+  dev->i2c_fd = open(i2c_adaptor, O_RDWR);
+  if (dev->i2c_fd < 0) {
     return ERROR_DEVICE;
   }
 
   // Set settings for I2C
   int rv = 0;
-  rv = ioctl(i2c_fd, I2C_SLAVE, BME280_ADDRESS);
+  rv = ioctl(dev->i2c_fd, I2C_SLAVE, BME280_ADDRESS);
   if (rv < 0) {
+    close(dev->i2c_fd);
+    dev->i2c_fd = -1;
     return ERROR_I2C;
   }
 
   uint8_t id = 0;
-  rv = BME280_get_chip_id(&id);
+  rv = BME280_get_chip_id(dev, &id);
   if (id != BME280_CHIP_ID) {
     debug_print(stderr, "Chip ID 0x%x does not match 0x%x\n", id, BME280_CHIP_ID);
     return ERROR_DEVICE;
@@ -177,15 +168,25 @@ int BME280_init(const char *i2c_adaptor) {
   }
 
   // Read compensation parameters
-  rv |= read_calibration();
+  rv |= read_calibration(dev->i2c_fd, &dev->calib);
   if (rv) {
     return rv;
   }
 
+  dev->compensation = BME280_COMPENSATION;
+
+  // Software filtering starts off disabled, with the usual Hampel threshold
+  memset(&dev->sw_filter_config, 0, sizeof(dev->sw_filter_config));
+  dev->sw_filter_config.hampel_threshold = 3 * SW_FILTER_THRESHOLD_ONE;
+  for (int channel = 0; channel < 3; channel++) {
+    BME280_sw_filter_reset(&dev->sw_filters[channel]);
+  }
+
   // Set default configuration
-  rv |= BME280_set_config(MS250, FILTER_16);
-  rv |= BME280_set_ctrl_hum(H_OVERSAMPLE_8);
-  rv |= BME280_set_ctrl_meas(T_OVERSAMPLE_1, P_OVERSAMPLE_4, NORMAL);
+  struct BME280_profile profile = {
+    H_OVERSAMPLE_8, T_OVERSAMPLE_1, P_OVERSAMPLE_4, NORMAL, MS250, FILTER_16
+  };
+  rv |= BME280_set_profile(dev, &profile);
   if (rv) {
     debug_print(stderr, "%s\n", "Could not set default config");
     return ERROR_I2C;
@@ -194,105 +195,128 @@ int BME280_init(const char *i2c_adaptor) {
   return NO_ERROR;
 }
 
-int BME280_deinit(void) {
-  close(i2c_fd);
+int BME280_deinit(struct BME280_dev *dev) {
+  if (dev->i2c_fd >= 0) {
+    close(dev->i2c_fd);
+    dev->i2c_fd = -1;
+  }
   return NO_ERROR;
 }
 
-int BME280_measure(double *pressure_out,
-                   double *temperature_out,
-                   double *humidity_out) {
+int BME280_read_raw(struct BME280_dev *dev, struct BME280_raw *raw_out) {
   int rv = 0;
-  double pressure = 0, temperature = 0, humidity = 0;
 
-  // Read temperature data
-  uint8_t rx_temp[3];
-  read_bytes(i2c_fd, BME280_TEMP_MSB, rx_temp, 3);
-  int32_t t = (rx_temp[0] << 16 | rx_temp[1] << 8 | rx_temp[2]) >> 4;
-  rv |= compensate_temperature(t, &temperature);
-  if (rv) {
-    debug_print(stderr, "%s\n", "Could not compensate temperature");
-    return rv;
+  if (dev->profile.mode == FORCED) {
+    rv = trigger_forced_measurement(dev);
+    if (rv) {
+      return rv;
+    }
   }
 
-  // Read pressure data
-  uint8_t rx_pres[3];
-  read_bytes(i2c_fd, BME280_PRESS_MSB, rx_pres, 3);
-  int32_t p = (rx_pres[0] << 16 | rx_pres[1] << 8 | rx_pres[2]) >> 4;
-  rv |= compensate_pressure(p, &pressure);
+  // Pressure, temperature and humidity data are contiguous from 0xF7
+  uint8_t rx[8];
+  rv = read_bytes(dev->i2c_fd, BME280_PRESS_MSB, rx, 8);
   if (rv) {
-    debug_print(stderr, "%s\n", "Could not compensate pressure");
-    return rv;
+    debug_print(stderr, "%s\n", "Could not read data");
+    return ERROR_I2C;
   }
 
-  // Read humidity data
-  uint8_t rx_hum[2];
-  read_bytes(i2c_fd, BME280_HUM_MSB, rx_hum, 2);
-  int32_t h = (rx_hum[0] << 8 | rx_hum[1]) & 0xFFFF;
-  rv |= compensate_humidity(h, &humidity);
+  raw_out->pressure = (rx[0] << 16 | rx[1] << 8 | rx[2]) >> 4;
+  raw_out->temperature = (rx[3] << 16 | rx[4] << 8 | rx[5]) >> 4;
+  raw_out->humidity = (rx[6] << 8 | rx[7]) & 0xFFFF;
+  return NO_ERROR;
+}
+
+// Reads raw values and runs them through the software filter, so spikes
+// are rejected before compensation. Each call pushes one conversion; the
+// plugin reads far less often than the chip converts, so it is always new.
+static int read_filtered(struct BME280_dev *dev, struct BME280_raw *raw_out) {
+  int rv = BME280_read_raw(dev, raw_out);
   if (rv) {
-    debug_print(stderr, "%s\n", "Could not compensate humidity");
+    // A decimated output should not average across a missed conversion
+    for (int channel = 0; channel < 3; channel++) {
+      BME280_sw_filter_drop_window(&dev->sw_filters[channel]);
+    }
     return rv;
   }
 
-  *pressure_out = pressure;
-  *temperature_out = temperature;
-  *humidity_out = humidity;
+  raw_out->pressure = BME280_sw_filter_push(&dev->sw_filters[0],
+      &dev->sw_filter_config, raw_out->pressure);
+  raw_out->temperature = BME280_sw_filter_push(&dev->sw_filters[1],
+      &dev->sw_filter_config, raw_out->temperature);
+  raw_out->humidity = BME280_sw_filter_push(&dev->sw_filters[2],
+      &dev->sw_filter_config, raw_out->humidity);
   return NO_ERROR;
 }
 
-int BME280_get_config(uint8_t *standby_out,
-                      uint8_t *filter_coefficient_out) {
-  int rv = 0;
-  uint8_t config_rx;
+int BME280_measure(struct BME280_dev *dev,
+                   double *pressure_out,
+                   double *temperature_out,
+                   double *humidity_out) {
+  struct BME280_raw raw;
+  int rv = read_filtered(dev, &raw);
+  if (rv) {
+    return rv;
+  }
 
-  rv = read_bytes(i2c_fd, BME280_CONFIG_REG, &config_rx, 1);
+  rv = BME280_compensate(&dev->calib, dev->compensation, &raw,
+                         pressure_out, temperature_out, humidity_out);
   if (rv) {
-    debug_print(stderr, "%s\n", "Could not read config");
+    debug_print(stderr, "%s\n", "Could not compensate measurement");
     return rv;
   }
 
-  *standby_out = config_rx & 0xE0;
-  *filter_coefficient_out = config_rx & 0x1C;
   return NO_ERROR;
 }
 
-int BME280_get_ctrl_hum(uint8_t *osrs_h_out) {
-  uint8_t ctrl_hum;
-  int rv = read_bytes(i2c_fd, BME280_CTRL_HUM_REG, &ctrl_hum, 1);
+int BME280_measure_fixed(struct BME280_dev *dev,
+                         struct BME280_fixed *fixed_out) {
+  struct BME280_raw raw;
+  int rv = read_filtered(dev, &raw);
+  if (rv) {
+    return rv;
+  }
+
+  rv = BME280_compensate_fixed(&dev->calib, dev->compensation, &raw, fixed_out);
   if (rv) {
-    debug_print(stderr, "%s\n", "Could not get ctrl meas");
+    debug_print(stderr, "%s\n", "Could not compensate measurement");
     return rv;
   }
 
-  *osrs_h_out = ctrl_hum;
   return NO_ERROR;
 }
 
-int BME280_get_ctrl_meas(uint8_t *osrs_p_out,
-                         uint8_t *osrs_t_out,
-                         uint8_t *mode_out) {
-  int rv = 0;
-  uint8_t ctrl_meas_rx;
+// Settings getters are served from the cached profile; no bus access
+int BME280_get_config(struct BME280_dev *dev,
+                      uint8_t *standby_out,
+                      uint8_t *filter_coefficient_out) {
+  *standby_out = dev->profile.standby;
+  *filter_coefficient_out = dev->profile.filter_coefficient;
+  return NO_ERROR;
+}
 
-  rv = read_bytes(i2c_fd, BME280_CTRL_MEAS_REG, &ctrl_meas_rx, 1);
-  if (rv) {
-    debug_print(stderr, "%s\n", "Could not get ctrl meas");
-    return rv;
-  }
+int BME280_get_ctrl_hum(struct BME280_dev *dev, uint8_t *osrs_h_out) {
+  *osrs_h_out = dev->profile.osrs_h;
+  return NO_ERROR;
+}
 
-  *osrs_p_out = ctrl_meas_rx & 0x1C;
-  *osrs_t_out = ctrl_meas_rx & 0xE0;
-  *mode_out = ctrl_meas_rx & 0x03;
+int BME280_get_ctrl_meas(struct BME280_dev *dev,
+                         uint8_t *osrs_p_out,
+                         uint8_t *osrs_t_out,
+                         uint8_t *mode_out) {
+  *osrs_p_out = dev->profile.osrs_p;
+  *osrs_t_out = dev->profile.osrs_t;
+  *mode_out = dev->profile.mode;
   return NO_ERROR;
 }
 
-int BME280_get_status(uint8_t *measuring_out,
+int BME280_get_status(struct BME280_dev *dev,
+                      uint8_t *measuring_out,
                       uint8_t *im_update_out) {
   int rv = 0;
   uint8_t status_rx;
 
-  rv = read_bytes(i2c_fd, BME280_STATUS_REG, &status_rx, 1);
+  rv = read_bytes(dev->i2c_fd, BME280_STATUS_REG, &status_rx, 1);
   if (rv) {
     debug_print(stderr, "%s\n", "Could not get status");
     return rv;
@@ -303,11 +327,11 @@ int BME280_get_status(uint8_t *measuring_out,
   return NO_ERROR;
 }
 
-int BME280_get_chip_id(uint8_t *id_out) {
+int BME280_get_chip_id(struct BME280_dev *dev, uint8_t *id_out) {
   int rv = 0;
   uint8_t id_rx;
 
-  rv = read_bytes(i2c_fd, BME280_ID_REG, &id_rx, 1);
+  rv = read_bytes(dev->i2c_fd, BME280_ID_REG, &id_rx, 1);
   if (rv) {
     debug_print(stderr, "Return value from read_bytes is %d\n", rv);
     return rv;
@@ -317,20 +341,130 @@ int BME280_get_chip_id(uint8_t *id_out) {
   return NO_ERROR;
 }
 
-int BME280_set_config(uint8_t standby,
+int BME280_get_profile(struct BME280_dev *dev,
+                       struct BME280_profile *profile_out) {
+  *profile_out = dev->profile;
+  return NO_ERROR;
+}
+
+int BME280_get_preset(enum Preset preset,
+                      struct BME280_profile *profile_out) {
+  if (preset < 0 || preset >= PRESET_COUNT) {
+    return ERROR_INVAL;
+  }
+
+  *profile_out = presets[preset];
+  return NO_ERROR;
+}
+
+int BME280_get_sw_filter(struct BME280_dev *dev,
+                         struct BME280_sw_filter_config *config_out) {
+  *config_out = dev->sw_filter_config;
+  return NO_ERROR;
+}
+
+int BME280_get_compensation(struct BME280_dev *dev,
+                            enum Compensation *compensation_out) {
+  *compensation_out = dev->compensation;
+  return NO_ERROR;
+}
+
+// Single-register setters go through BME280_set_profile(), so the chip is
+// asleep while config is written, ctrl_hum is followed by a ctrl_meas
+// write, and the cache only changes once the chip has applied the values
+int BME280_set_config(struct BME280_dev *dev,
+                      uint8_t standby,
                       uint8_t filter_coefficient) {
-  uint8_t config_tx = (standby | filter_coefficient) & 0xFE;
-  return write_bytes(i2c_fd, BME280_CONFIG_REG, &config_tx, 1);
+  struct BME280_profile profile = dev->profile;
+  profile.standby = standby;
+  profile.filter_coefficient = filter_coefficient;
+  return BME280_set_profile(dev, &profile);
 }
 
-int BME280_set_ctrl_hum(uint8_t osrs_h) {
-  return write_bytes(i2c_fd, BME280_CTRL_HUM_REG, &osrs_h, 1);
+int BME280_set_ctrl_hum(struct BME280_dev *dev, uint8_t osrs_h) {
+  struct BME280_profile profile = dev->profile;
+  profile.osrs_h = osrs_h;
+  return BME280_set_profile(dev, &profile);
 }
 
-int BME280_set_ctrl_meas(uint8_t osrs_p,
+int BME280_set_ctrl_meas(struct BME280_dev *dev,
+                         uint8_t osrs_p,
                          uint8_t osrs_t,
                          uint8_t mode) {
-  uint8_t ctrl_meas_tx = (osrs_p | osrs_t | mode);
-  return write_bytes(i2c_fd, BME280_CTRL_MEAS_REG, &ctrl_meas_tx, 1);
+  struct BME280_profile profile = dev->profile;
+  profile.osrs_p = osrs_p;
+  profile.osrs_t = osrs_t;
+  profile.mode = mode;
+  return BME280_set_profile(dev, &profile);
 }
 
+int BME280_set_profile(struct BME280_dev *dev,
+                       const struct BME280_profile *profile) {
+  if (!profile_is_valid(profile)) {
+    return ERROR_INVAL;
+  }
+
+  // Forced measurements are started by measure(), so leave the chip asleep
+  uint8_t mode = (profile->mode == FORCED) ? SLEEP : profile->mode;
+  uint8_t ctrl_hum = profile->osrs_h;
+  uint8_t config = profile->standby | profile->filter_coefficient;
+  uint8_t ctrl_meas = profile->osrs_t | profile->osrs_p | mode;
+
+  // Sleep first, since config writes may be ignored in normal mode, and
+  // ctrl_hum only takes effect after the following write to ctrl_meas
+  uint8_t tx[] = {
+    BME280_CTRL_MEAS_REG, SLEEP,
+    BME280_CTRL_HUM_REG,  ctrl_hum,
+    BME280_CONFIG_REG,    config,
+    BME280_CTRL_MEAS_REG, ctrl_meas
+  };
+  int rv = write_pairs(dev->i2c_fd, tx, sizeof(tx));
+  if (rv) {
+    debug_print(stderr, "%s\n", "Could not write profile");
+    return ERROR_I2C;
+  }
+
+  // ctrl_hum, status, ctrl_meas and config are contiguous
+  uint8_t rx[4];
+  rv = read_bytes(dev->i2c_fd, BME280_CTRL_HUM_REG, rx, sizeof(rx));
+  if (rv) {
+    debug_print(stderr, "%s\n", "Could not read back profile");
+    return ERROR_I2C;
+  }
+
+  if ((rx[0] & 0x07) != ctrl_hum || rx[2] != ctrl_meas ||
+      (rx[3] & 0xFC) != config) {
+    debug_print(stderr, "Profile readback 0x%x 0x%x 0x%x does not match\n",
+                rx[0], rx[2], rx[3]);
+    return ERROR_VERIFY;
+  }
+
+  dev->profile = *profile;
+  return NO_ERROR;
+}
+
+int BME280_set_sw_filter(struct BME280_dev *dev,
+                         const struct BME280_sw_filter_config *config) {
+  int rv = BME280_sw_filter_validate(config);
+  if (rv) {
+    return rv;
+  }
+
+  dev->sw_filter_config = *config;
+  for (int channel = 0; channel < 3; channel++) {
+    BME280_sw_filter_reset(&dev->sw_filters[channel]);
+  }
+  return NO_ERROR;
+}
+
+int BME280_set_compensation(struct BME280_dev *dev,
+                            enum Compensation compensation) {
+  if (compensation != COMPENSATION_INT64 &&
+      compensation != COMPENSATION_INT32 &&
+      compensation != COMPENSATION_FLOAT) {
+    return ERROR_INVAL;
+  }
+
+  dev->compensation = compensation;
+  return NO_ERROR;
+}
@@ -1,6 +1,8 @@
 #ifndef BME280
 #define BME280
 
+#include "sw_filter.h"
+
 #include <stdint.h>
 #include <stdio.h>
 
@@ -18,7 +20,8 @@ enum Error {
   ERROR_DEVICE,         // Couldn't find device
   ERROR_DRIVER,         // Driver failed to init
   ERROR_INVAL,          // Invalid argument
-  ERROR_I2C             // I2C driver failed to read or write data
+  ERROR_I2C,            // I2C driver failed to read or write data
+  ERROR_VERIFY          // Registers read back differently than written
 };
 
 // Chip defines
@@ -75,6 +78,28 @@ enum Mode {
   NORMAL            = 0x03
 };
 
+// Recommended modes of operation, from section 3.5 of the datasheet
+enum Preset {
+  PRESET_WEATHER_MONITORING,
+  PRESET_HUMIDITY_SENSING,
+  PRESET_INDOOR_NAVIGATION,
+  PRESET_GAMING,
+  PRESET_COUNT
+};
+
+// Ways to convert raw ADC values, all from the datasheet
+enum Compensation {
+  COMPENSATION_INT64,   // 64-bit integer pressure; the reference
+  COMPENSATION_INT32,   // 32-bit integer pressure, in whole Pa
+  COMPENSATION_FLOAT    // Floating point formulas, in single precision
+};
+
+// Variant used by newly initialized devices; can be changed at build time,
+// e.g. make COMPENSATION=INT32 or npm install --bme280_compensation=INT32
+#ifndef BME280_COMPENSATION
+#define BME280_COMPENSATION COMPENSATION_INT64
+#endif
+
 #define BME280_ADDRESS 0x76
 #define BME280_MEASURING 0x08
 #define BME280_IM_UPDATE 0x01
@@ -117,31 +142,110 @@ enum Mode {
 #define BME280_DIG_H5_REG 0xE5
 #define BME280_DIG_H6_REG 0xE7
 
+// Calibration constants for compensation, unique to each chip
+struct BME280_calib {
+  uint16_t dig_T1;
+  int16_t dig_T2, dig_T3;
+  uint16_t dig_P1;
+  int16_t dig_P2, dig_P3, dig_P4, dig_P5, dig_P6, dig_P7, dig_P8, dig_P9;
+  uint8_t dig_H1, dig_H3;
+  int16_t dig_H2, dig_H4, dig_H5;
+  int8_t dig_H6;
+};
+
+// Everything in ctrl_hum, ctrl_meas and config, using the enum values above
+struct BME280_profile {
+  uint8_t osrs_h;
+  uint8_t osrs_t;
+  uint8_t osrs_p;
+  uint8_t mode;
+  uint8_t standby;
+  uint8_t filter_coefficient;
+};
+
+// Uncompensated ADC values
+struct BME280_raw {
+  int32_t pressure;
+  int32_t temperature;
+  int32_t humidity;
+};
+
+// Compensated values without conversion to floating point
+struct BME280_fixed {
+  uint32_t pressure;     // Pa * 256
+  int32_t temperature;   // 0.01 degrees C
+  uint32_t humidity;     // %RH * 1024
+};
+
+// State for a single BME280; all functions below operate on one of these
+// instead of on global state, so several sensors (or several callers) can
+// be used from the same process. Calls on the same device are not
+// synchronized; callers sharing a device across threads must lock.
+struct BME280_dev {
+  int i2c_fd;
+  struct BME280_calib calib;
+  struct BME280_profile profile;  // Last settings written to the chip
+  enum Compensation compensation;
+  struct BME280_sw_filter_config sw_filter_config;
+  struct BME280_sw_filter sw_filters[3];  // Pressure, temperature, humidity
+};
+
 // Set up and tear down BME280 interface
-int BME280_init(const char *i2c_adaptor);
-int BME280_deinit(void);
+int BME280_init(struct BME280_dev *dev, const char *i2c_adaptor);
+int BME280_deinit(struct BME280_dev *dev);
 
 // Fetch data from BME280
-int BME280_measure(double *pressure_out,
+// Reads all ADC values in one burst, so they come from the same conversion
+int BME280_read_raw(struct BME280_dev *dev, struct BME280_raw *raw_out);
+int BME280_measure(struct BME280_dev *dev,
+                   double *pressure_out,
                    double *temperature_out,
                    double *humidity_out);
-int BME280_get_config(uint8_t *standby_out,
+// Like BME280_measure(), but returns fixed-point values; with
+// COMPENSATION_FLOAT selected, the float results are rounded to those units
+int BME280_measure_fixed(struct BME280_dev *dev,
+                         struct BME280_fixed *fixed_out);
+// Settings come from the cached profile, without bus access
+int BME280_get_config(struct BME280_dev *dev,
+                      uint8_t *standby_out,
                       uint8_t *filter_coefficient_out);
-int BME280_get_ctrl_hum(uint8_t *osrs_h_out);
-int BME280_get_ctrl_meas(uint8_t *osrs_p_out,
+int BME280_get_ctrl_hum(struct BME280_dev *dev, uint8_t *osrs_h_out);
+int BME280_get_ctrl_meas(struct BME280_dev *dev,
+                         uint8_t *osrs_p_out,
                          uint8_t *osrs_t_out,
                          uint8_t *mode_out);
-int BME280_get_status(uint8_t *measuring_out,
+int BME280_get_status(struct BME280_dev *dev,
+                      uint8_t *measuring_out,
                       uint8_t *im_update_out);
-int BME280_get_chip_id(uint8_t *id_out);
-
-// Set data in BME280
-int BME280_set_config(uint8_t standby,
+int BME280_get_chip_id(struct BME280_dev *dev, uint8_t *id_out);
+// Returns the cached profile; does not touch the bus
+int BME280_get_profile(struct BME280_dev *dev,
+                       struct BME280_profile *profile_out);
+int BME280_get_preset(enum Preset preset,
+                      struct BME280_profile *profile_out);
+int BME280_get_sw_filter(struct BME280_dev *dev,
+                         struct BME280_sw_filter_config *config_out);
+int BME280_get_compensation(struct BME280_dev *dev,
+                            enum Compensation *compensation_out);
+
+// Set data in BME280; single-register setters apply the cached profile with
+// the given fields changed, through BME280_set_profile()
+int BME280_set_config(struct BME280_dev *dev,
+                      uint8_t standby,
                       uint8_t filter_coefficient);
-int BME280_set_ctrl_hum(uint8_t osrs_h);
-int BME280_set_ctrl_meas(uint8_t osrs_p,
+int BME280_set_ctrl_hum(struct BME280_dev *dev, uint8_t osrs_h);
+int BME280_set_ctrl_meas(struct BME280_dev *dev,
+                         uint8_t osrs_p,
                          uint8_t osrs_t,
                          uint8_t mode);
+// Writes ctrl_hum, config and ctrl_meas in a single transaction, then reads
+// them back in a single transaction to check that they were applied
+int BME280_set_profile(struct BME280_dev *dev,
+                       const struct BME280_profile *profile);
+// Also clears any history kept by the previous filter settings
+int BME280_set_sw_filter(struct BME280_dev *dev,
+                         const struct BME280_sw_filter_config *config);
+int BME280_set_compensation(struct BME280_dev *dev,
+                            enum Compensation compensation);
 
 #endif // BME280
-
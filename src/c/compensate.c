@@ -0,0 +1,223 @@
+#include "compensate.h"
+
+#include <math.h>
+
+// Integer temperature from the datasheet; also produces t_fine, which
+// pressure and humidity compensation depend on. Output in 0.01 degrees C.
+static int32_t compensate_temperature(const struct BME280_calib *calib,
+                                      int32_t t_in, int32_t *t_fine) {
+  int32_t var1, var2;
+
+  var1 = ((((t_in >> 3) - ((int32_t)calib->dig_T1 << 1))) * ((int32_t)calib->dig_T2)) >> 11;
+  var2 = (((((t_in >> 4) - ((int32_t)calib->dig_T1)) * ((t_in >> 4) - ((int32_t)calib->dig_T1))) >> 12) *
+      ((int32_t)calib->dig_T3)) >> 14;
+  *t_fine = var1 + var2;
+  return (*t_fine * 5 + 128) >> 8;
+}
+
+// 64-bit integer pressure from the datasheet; output in Pa * 256
+static uint32_t compensate_pressure_int64(const struct BME280_calib *calib,
+                                          int32_t t_fine, int32_t p_in) {
+  int64_t var1, var2, p;
+  var1 = ((int64_t)t_fine) - 128000;
+  var2 = var1 * var1 * (int64_t)calib->dig_P6;
+  var2 = var2 + ((var1 * (int64_t)calib->dig_P5) << 17);
+  var2 = var2 + (((int64_t)calib->dig_P4) << 35);
+  var1 = ((var1 * var1 * (int64_t)calib->dig_P3) >> 8) + ((var1 * (int64_t)calib->dig_P2) << 12);
+  var1 = ((((int64_t)1) << 47) + var1) * ((int64_t)calib->dig_P1) >> 33;
+
+  if (!var1) {
+    debug_print(stdout, "%s\n", "Pressure compensation: var1 == 0");
+    return 0;
+  }
+
+  p = 1048576 - p_in;
+  p = (((p << 31) - var2) * 3125) / var1;
+  var1 = (((int64_t)calib->dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+  var2 = (((int64_t)calib->dig_P8) * p) >> 19;
+  p = ((p + var1 + var2) >> 8) + (((int64_t)calib->dig_P7) << 4);
+  return (uint32_t)p;
+}
+
+// 32-bit integer pressure from the datasheet, for CPUs without a fast
+// 64-bit multiply; output in whole Pa
+static uint32_t compensate_pressure_int32(const struct BME280_calib *calib,
+                                          int32_t t_fine, int32_t p_in) {
+  int32_t var1, var2;
+  uint32_t p;
+  var1 = (t_fine >> 1) - (int32_t)64000;
+  var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * ((int32_t)calib->dig_P6);
+  var2 = var2 + ((var1 * ((int32_t)calib->dig_P5)) << 1);
+  var2 = (var2 >> 2) + (((int32_t)calib->dig_P4) << 16);
+  var1 = (((calib->dig_P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) +
+      ((((int32_t)calib->dig_P2) * var1) >> 1)) >> 18;
+  var1 = ((32768 + var1) * ((int32_t)calib->dig_P1)) >> 15;
+
+  if (!var1) {
+    debug_print(stdout, "%s\n", "Pressure compensation: var1 == 0");
+    return 0;
+  }
+
+  p = (((uint32_t)(((int32_t)1048576) - p_in)) - (var2 >> 12)) * 3125;
+  if (p < 0x80000000) {
+    p = (p << 1) / ((uint32_t)var1);
+  } else {
+    p = (p / (uint32_t)var1) * 2;
+  }
+  var1 = (((int32_t)calib->dig_P9) * ((int32_t)(((p >> 3) * (p >> 3)) >> 13))) >> 12;
+  var2 = (((int32_t)(p >> 2)) * ((int32_t)calib->dig_P8)) >> 13;
+  p = (uint32_t)((int32_t)p + ((var1 + var2 + calib->dig_P7) >> 4));
+  return p;
+}
+
+// Integer humidity from the datasheet; output in %RH * 1024
+static uint32_t compensate_humidity(const struct BME280_calib *calib,
+                                    int32_t t_fine, int32_t h_in) {
+  int32_t var1;
+
+  var1 = (t_fine - ((int32_t)76800));
+  var1 = (((((h_in << 14) - (((int32_t)calib->dig_H4) << 20) - (((int32_t)calib->dig_H5) *
+      var1)) + ((int32_t)16384)) >> 15) * (((((((var1 *
+      ((int32_t)calib->dig_H6)) >> 10) * (((var1 * ((int32_t)calib->dig_H3)) >> 11) +
+      ((int32_t)32768))) >> 10) + ((int32_t)2097152)) * ((int32_t)calib->dig_H2) +
+      8192) >> 14));
+  var1 = (var1 - (((((var1 >> 15) * (var1 >> 15)) >> 7) * ((uint32_t)calib->dig_H1)) >> 4));
+  var1 = (var1 < 0 ? 0 : var1);
+  var1 = (var1 > 419430400 ? 419430400 : var1);
+  return (uint32_t)(var1 >> 12);
+}
+
+// Floating point formulas from the datasheet, in single precision
+static void compensate_float(const struct BME280_calib *calib,
+                             const struct BME280_raw *raw,
+                             float *p_out, float *t_out, float *h_out) {
+  float var1, var2, t_fine, p, h;
+
+  var1 = ((float)raw->temperature / 16384.0f - (float)calib->dig_T1 / 1024.0f) *
+      (float)calib->dig_T2;
+  var2 = (float)raw->temperature / 131072.0f - (float)calib->dig_T1 / 8192.0f;
+  var2 = var2 * var2 * (float)calib->dig_T3;
+  t_fine = var1 + var2;
+  *t_out = t_fine / 5120.0f;
+
+  var1 = t_fine / 2.0f - 64000.0f;
+  var2 = var1 * var1 * (float)calib->dig_P6 / 32768.0f;
+  var2 = var2 + var1 * (float)calib->dig_P5 * 2.0f;
+  var2 = var2 / 4.0f + (float)calib->dig_P4 * 65536.0f;
+  var1 = ((float)calib->dig_P3 * var1 * var1 / 524288.0f +
+      (float)calib->dig_P2 * var1) / 524288.0f;
+  var1 = (1.0f + var1 / 32768.0f) * (float)calib->dig_P1;
+  if (var1 == 0.0f) {
+    p = 0;
+  } else {
+    p = 1048576.0f - (float)raw->pressure;
+    p = (p - var2 / 4096.0f) * 6250.0f / var1;
+    var1 = (float)calib->dig_P9 * p * p / 2147483648.0f;
+    var2 = p * (float)calib->dig_P8 / 32768.0f;
+    p = p + (var1 + var2 + (float)calib->dig_P7) / 16.0f;
+  }
+  *p_out = p;
+
+  h = t_fine - 76800.0f;
+  h = ((float)raw->humidity - ((float)calib->dig_H4 * 64.0f +
+      (float)calib->dig_H5 / 16384.0f * h)) *
+      ((float)calib->dig_H2 / 65536.0f * (1.0f + (float)calib->dig_H6 / 67108864.0f * h *
+      (1.0f + (float)calib->dig_H3 / 67108864.0f * h)));
+  h = h * (1.0f - (float)calib->dig_H1 * h / 524288.0f);
+  h = (h > 100.0f ? 100.0f : h);
+  h = (h < 0.0f ? 0.0f : h);
+  *h_out = h;
+}
+
+int BME280_compensate_fixed(const struct BME280_calib *calib,
+                            enum Compensation variant,
+                            const struct BME280_raw *raw,
+                            struct BME280_fixed *fixed_out) {
+  int32_t t_fine;
+
+  switch (variant) {
+    case COMPENSATION_INT64:
+      fixed_out->temperature = compensate_temperature(calib, raw->temperature, &t_fine);
+      fixed_out->pressure = compensate_pressure_int64(calib, t_fine, raw->pressure);
+      break;
+    case COMPENSATION_INT32:
+      // Only whole pascals, shifted to match the 64-bit output
+      fixed_out->temperature = compensate_temperature(calib, raw->temperature, &t_fine);
+      fixed_out->pressure = compensate_pressure_int32(calib, t_fine, raw->pressure) << 8;
+      break;
+    case COMPENSATION_FLOAT: {
+      // Rounded to the same units as the integer variants
+      float pressure, temperature, humidity;
+      compensate_float(calib, raw, &pressure, &temperature, &humidity);
+      fixed_out->pressure = (uint32_t)lroundf(pressure * 256.0f);
+      fixed_out->temperature = (int32_t)lroundf(temperature * 100.0f);
+      fixed_out->humidity = (uint32_t)lroundf(humidity * 1024.0f);
+      return NO_ERROR;
+    }
+    default:
+      return ERROR_INVAL;
+  }
+
+  fixed_out->humidity = compensate_humidity(calib, t_fine, raw->humidity);
+  return NO_ERROR;
+}
+
+int BME280_compensate(const struct BME280_calib *calib,
+                      enum Compensation variant,
+                      const struct BME280_raw *raw,
+                      double *pressure_out,
+                      double *temperature_out,
+                      double *humidity_out) {
+  if (variant == COMPENSATION_FLOAT) {
+    float pressure, temperature, humidity;
+    compensate_float(calib, raw, &pressure, &temperature, &humidity);
+    *pressure_out = pressure;
+    *temperature_out = temperature;
+    *humidity_out = humidity;
+    return NO_ERROR;
+  }
+
+  struct BME280_fixed fixed;
+  int rv = BME280_compensate_fixed(calib, variant, raw, &fixed);
+  if (rv) {
+    return rv;
+  }
+
+  *pressure_out = fixed.pressure / 256.0;
+  *temperature_out = fixed.temperature / 100.0;
+  *humidity_out = fixed.humidity / 1024.0;
+  return NO_ERROR;
+}
+
+int BME280_compare_compensation(const struct BME280_calib *calib,
+                                enum Compensation variant,
+                                struct BME280_deviation *max_out) {
+  max_out->pressure = 0;
+  max_out->temperature = 0;
+  max_out->humidity = 0;
+
+  // Covers far more than the ADC values any real chip produces; readings
+  // outside -40..85 degrees C and 300..1100 hPa are skipped
+  struct BME280_raw raw;
+  for (raw.temperature = 300000; raw.temperature <= 700000; raw.temperature += 4000) {
+    for (raw.pressure = 150000; raw.pressure <= 650000; raw.pressure += 5000) {
+      for (raw.humidity = 15000; raw.humidity <= 55000; raw.humidity += 2500) {
+        double p_ref, t_ref, h_ref, p, t, h;
+        int rv = BME280_compensate(calib, COMPENSATION_INT64, &raw, &p_ref, &t_ref, &h_ref);
+        rv |= BME280_compensate(calib, variant, &raw, &p, &t, &h);
+        if (rv) {
+          return rv;
+        }
+
+        if (t_ref < -40 || t_ref > 85 || p_ref < 30000 || p_ref > 110000) {
+          continue;
+        }
+        max_out->pressure = fmax(max_out->pressure, fabs(p - p_ref));
+        max_out->temperature = fmax(max_out->temperature, fabs(t - t_ref));
+        max_out->humidity = fmax(max_out->humidity, fabs(h - h_ref));
+      }
+    }
+  }
+
+  return NO_ERROR;
+}
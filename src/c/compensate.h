@@ -0,0 +1,33 @@
+#ifndef BME280_COMPENSATE
+#define BME280_COMPENSATE
+
+#include "bme280.h"
+
+// Converts raw ADC values to fixed-point outputs with any variant;
+// COMPENSATION_FLOAT results are rounded to the fixed-point units
+int BME280_compensate_fixed(const struct BME280_calib *calib,
+                            enum Compensation variant,
+                            const struct BME280_raw *raw,
+                            struct BME280_fixed *fixed_out);
+
+// Converts raw ADC values to pascals, degrees C and %RH with any variant
+int BME280_compensate(const struct BME280_calib *calib,
+                      enum Compensation variant,
+                      const struct BME280_raw *raw,
+                      double *pressure_out,
+                      double *temperature_out,
+                      double *humidity_out);
+
+// Largest differences between a variant and COMPENSATION_INT64, over raw
+// values that give readings in the sensor's operating range
+struct BME280_deviation {
+  double pressure;      // Pa
+  double temperature;   // degrees C
+  double humidity;      // %RH
+};
+
+int BME280_compare_compensation(const struct BME280_calib *calib,
+                                enum Compensation variant,
+                                struct BME280_deviation *max_out);
+
+#endif // BME280_COMPENSATE
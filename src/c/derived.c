@@ -0,0 +1,57 @@
+#include "derived.h"
+#include "bme280.h"
+
+#include <math.h>
+
+// Magnus formula coefficients over water (Sonntag 1990)
+#define MAGNUS_A 6.112    // hPa
+#define MAGNUS_B 17.62
+#define MAGNUS_C 243.12   // degrees C
+
+// International barometric formula
+#define STANDARD_PRESSURE 101325.0  // Pa
+#define ALTITUDE_EXPONENT 5.255
+
+// Each loop below only reads and writes its own arrays and has no branches,
+// so the compiler is free to vectorize it
+int BME280_derive(double *buffer, size_t count, double elevation) {
+  if (!buffer || elevation >= DERIVED_MAX_ELEVATION) {
+    return ERROR_INVAL;
+  }
+
+  const double *restrict pressure = buffer + CHANNEL_PRESSURE * count;
+  const double *restrict temperature = buffer + CHANNEL_TEMPERATURE * count;
+  const double *restrict humidity = buffer + CHANNEL_HUMIDITY * count;
+  double *restrict dew_point = buffer + CHANNEL_DEW_POINT * count;
+  double *restrict absolute_humidity = buffer + CHANNEL_ABSOLUTE_HUMIDITY * count;
+  double *restrict altitude = buffer + CHANNEL_ALTITUDE * count;
+  double *restrict sea_level_pressure = buffer + CHANNEL_SEA_LEVEL_PRESSURE * count;
+
+  for (size_t i = 0; i < count; i++) {
+    // Humidity can compensate to exactly 0%, where the dew point is undefined
+    double rh = fmax(humidity[i], 0.01) / 100.0;
+    double t = temperature[i];
+    double magnus = MAGNUS_B * t / (MAGNUS_C + t);
+
+    double gamma = log(rh) + magnus;
+    dew_point[i] = MAGNUS_C * gamma / (MAGNUS_B - gamma);
+
+    // Vapour pressure in hPa, then the ideal gas law for water vapour
+    double vapour_pressure = rh * MAGNUS_A * exp(magnus);
+    absolute_humidity[i] = 216.7 * vapour_pressure / (273.15 + t);
+  }
+
+  // pow(x, y) written as exp(y * log(x)), which has vector variants
+  for (size_t i = 0; i < count; i++) {
+    altitude[i] = DERIVED_ALTITUDE_SCALE *
+        (1.0 - exp(log(pressure[i] / STANDARD_PRESSURE) / ALTITUDE_EXPONENT));
+  }
+
+  // The reduction to sea level is the same factor for every sample
+  double reduction = pow(1.0 - elevation / DERIVED_ALTITUDE_SCALE, -ALTITUDE_EXPONENT);
+  for (size_t i = 0; i < count; i++) {
+    sea_level_pressure[i] = pressure[i] * reduction;
+  }
+
+  return NO_ERROR;
+}
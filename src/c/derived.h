@@ -0,0 +1,32 @@
+#ifndef BME280_DERIVED
+#define BME280_DERIVED
+
+#include <stddef.h>
+
+// Layout of a result buffer holding count samples: each quantity occupies
+// count consecutive doubles, in this order. Callers fill in the first three;
+// BME280_derive() fills in the rest.
+enum Derived_Channel {
+  CHANNEL_PRESSURE,             // Pa
+  CHANNEL_TEMPERATURE,          // degrees C
+  CHANNEL_HUMIDITY,             // %RH
+  CHANNEL_DEW_POINT,            // degrees C
+  CHANNEL_ABSOLUTE_HUMIDITY,    // g/m^3
+  CHANNEL_ALTITUDE,             // m, pressure altitude in the standard atmosphere
+  CHANNEL_SEA_LEVEL_PRESSURE,   // Pa, reduced from the station's elevation
+  CHANNEL_COUNT
+};
+
+// Height scale of the international barometric formula, in metres
+#define DERIVED_ALTITUDE_SCALE 44330.0
+
+// Elevations at or above the scale height cannot be reduced to sea level
+#define DERIVED_MAX_ELEVATION DERIVED_ALTITUDE_SCALE
+
+// Computes the derived channels for count samples in buffer, which must
+// hold CHANNEL_COUNT * count doubles; elevation is the station's, in metres.
+// This file is built with -ffast-math, so callers must reject NaN and
+// infinite elevations themselves.
+int BME280_derive(double *buffer, size_t count, double elevation);
+
+#endif // BME280_DERIVED
@@ -0,0 +1,120 @@
+#include "sw_filter.h"
+#include "bme280.h"
+
+#include <string.h>
+
+// Scales the median absolute deviation to a standard deviation for
+// normally distributed noise; 1.4826 in units of SW_FILTER_THRESHOLD_ONE
+#define MAD_SCALE 1518
+
+// Median of the first count values; count is at most SW_FILTER_MAX_WINDOW
+static int32_t median(const int32_t *values, uint8_t count) {
+  int32_t sorted[SW_FILTER_MAX_WINDOW];
+  memcpy(sorted, values, count * sizeof(int32_t));
+
+  // Insertion sort is fastest at these sizes
+  for (int i = 1; i < count; i++) {
+    int32_t value = sorted[i];
+    int j = i - 1;
+    while (j >= 0 && sorted[j] > value) {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = value;
+  }
+
+  if (count % 2) {
+    return sorted[count / 2];
+  }
+  return (int32_t)(((int64_t)sorted[count / 2 - 1] + sorted[count / 2]) / 2);
+}
+
+// Adds value to a ring buffer of size window
+static void ring_push(int32_t *ring, uint8_t *count, uint8_t *head,
+                      uint8_t window, int32_t value) {
+  ring[*head] = value;
+  *head = (*head + 1) % window;
+  if (*count < window) {
+    (*count)++;
+  }
+}
+
+// Replaces sample with the window's median if it is further from it than
+// threshold scaled MADs
+static int32_t hampel(struct BME280_sw_filter *filter,
+                      const struct BME280_sw_filter_config *config,
+                      int32_t sample) {
+  ring_push(filter->raw, &filter->raw_count, &filter->raw_head,
+            config->hampel, sample);
+
+  int32_t center = median(filter->raw, filter->raw_count);
+  int32_t deviations[SW_FILTER_MAX_WINDOW];
+  for (int i = 0; i < filter->raw_count; i++) {
+    int32_t deviation = filter->raw[i] - center;
+    deviations[i] = deviation < 0 ? -deviation : deviation;
+  }
+
+  // Treat the MAD as at least one LSB, or a quiet signal would have every
+  // change rejected as a spike
+  int32_t mad = median(deviations, filter->raw_count);
+  mad = mad < 1 ? 1 : mad;
+
+  int32_t deviation = sample - center;
+  deviation = deviation < 0 ? -deviation : deviation;
+  if ((int64_t)deviation * SW_FILTER_THRESHOLD_ONE * SW_FILTER_THRESHOLD_ONE >
+      (int64_t)config->hampel_threshold * MAD_SCALE * mad) {
+    return center;
+  }
+  return sample;
+}
+
+int BME280_sw_filter_validate(const struct BME280_sw_filter_config *config) {
+  if (config->hampel > SW_FILTER_MAX_WINDOW ||
+      config->median > SW_FILTER_MAX_WINDOW ||
+      config->decimation > SW_FILTER_MAX_DECIMATION ||
+      (config->hampel > 1 && config->hampel_threshold == 0)) {
+    return ERROR_INVAL;
+  }
+  return NO_ERROR;
+}
+
+void BME280_sw_filter_reset(struct BME280_sw_filter *filter) {
+  memset(filter, 0, sizeof(*filter));
+}
+
+void BME280_sw_filter_drop_window(struct BME280_sw_filter *filter) {
+  filter->sum = 0;
+  filter->summed = 0;
+}
+
+int32_t BME280_sw_filter_push(struct BME280_sw_filter *filter,
+                              const struct BME280_sw_filter_config *config,
+                              int32_t sample) {
+  if (config->hampel > 1) {
+    sample = hampel(filter, config, sample);
+  }
+
+  if (config->median > 1) {
+    ring_push(filter->cleaned, &filter->cleaned_count, &filter->cleaned_head,
+              config->median, sample);
+    sample = median(filter->cleaned, filter->cleaned_count);
+  }
+
+  if (config->decimation > 1) {
+    filter->sum += sample;
+    filter->summed++;
+    if (filter->summed == config->decimation) {
+      // Rounded to nearest
+      filter->output = (int32_t)((filter->sum + config->decimation / 2) /
+                                 config->decimation);
+      filter->has_output = 1;
+      BME280_sw_filter_drop_window(filter);
+    } else if (!filter->has_output) {
+      filter->output = (int32_t)(filter->sum / filter->summed);
+    }
+  } else {
+    filter->output = sample;
+  }
+
+  return filter->output;
+}
@@ -0,0 +1,55 @@
+#ifndef BME280_SW_FILTER
+#define BME280_SW_FILTER
+
+#include <stdint.h>
+
+// Largest window for median and Hampel filtering; state is sized for this,
+// so memory per channel does not depend on the configuration
+#define SW_FILTER_MAX_WINDOW 15
+
+// Largest decimation; each output takes this many calls, so larger values
+// would hold readings for minutes at the plugin's refresh rate
+#define SW_FILTER_MAX_DECIMATION 16
+
+// Hampel thresholds are fixed point, so filtering stays in integers
+#define SW_FILTER_THRESHOLD_ONE 1024
+
+// Software filtering applied to raw ADC values before compensation, in
+// this order: Hampel spike rejection, median-of-N, decimating average.
+// A window or decimation of 0 or 1 disables that stage.
+struct BME280_sw_filter_config {
+  uint8_t hampel;            // Window for Hampel spike rejection
+  uint16_t hampel_threshold; // Deviations, in scaled MADs * 1024, treated
+                             // as spikes
+  uint8_t median;            // Window for median-of-N
+  uint8_t decimation;        // Samples averaged per output; only reduces
+                             // noise with the chip's IIR filter off
+};
+
+// State for one ADC channel
+struct BME280_sw_filter {
+  int32_t raw[SW_FILTER_MAX_WINDOW];      // Last inputs, for Hampel
+  int32_t cleaned[SW_FILTER_MAX_WINDOW];  // Last Hampel outputs, for median
+  uint8_t raw_count, raw_head;
+  uint8_t cleaned_count, cleaned_head;
+  int64_t sum;                            // Median outputs since last output
+  uint8_t summed;
+  int32_t output;
+  uint8_t has_output;
+};
+
+int BME280_sw_filter_validate(const struct BME280_sw_filter_config *config);
+void BME280_sw_filter_reset(struct BME280_sw_filter *filter);
+// Drops a partly averaged decimation window, e.g. after a failed read
+void BME280_sw_filter_drop_window(struct BME280_sw_filter *filter);
+
+// Feeds one raw sample through the filter and returns the latest output.
+// With decimation, a new output is ready after every decimation samples,
+// and until the first one is, the average so far is returned. Callers must
+// push one fresh conversion per call, since repeated reads of the same
+// conversion do not average out any noise.
+int32_t BME280_sw_filter_push(struct BME280_sw_filter *filter,
+                              const struct BME280_sw_filter_config *config,
+                              int32_t sample);
+
+#endif // BME280_SW_FILTER
@@ -1,7 +1,7 @@
 const BME280 = require('bindings')('homebridge-bme280');
 
-function measure() {
-  console.log(BME280.measure());
+function measure(device) {
+  console.log(BME280.measure(device));
 }
 
 function sleep(ms) {
@@ -9,15 +9,15 @@ function sleep(ms) {
 }
 
 async function test() {
-  BME280.init();
-  console.log(BME280.getChipID());
+  const device = BME280.init();
+  console.log(BME280.getChipID(device));
 
   for (i = 0; i < 60; i++) {
-    console.log(BME280.measure());
+    console.log(BME280.measure(device));
     await(sleep(1000));
   }
 
-  BME280.deinit();
+  BME280.deinit(device);
 }
 
 test();